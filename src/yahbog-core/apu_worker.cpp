@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <chrono>
+
+#include <yahbog/apu_worker.h>
+
+namespace yahbog {
+
+	apu_worker::apu_worker(apu& source) : m_source(source), m_shadow(std::make_unique<apu>(source)) {
+		m_shadow->m_clock = nullptr;
+		m_shadow->m_deferred = nullptr;
+		m_shadow->set_synthesis(true);
+
+		m_thread = std::jthread([this](std::stop_token stop) { run(stop); });
+		m_source.defer_synthesis(this);
+	}
+
+	apu_worker::~apu_worker() {
+		m_source.defer_synthesis(nullptr);
+		wait_idle();
+		m_thread.request_stop();
+	}
+
+	void apu_worker::record(const apu_log_entry& entry) {
+		m_recorded.fetch_add(1, std::memory_order_relaxed);
+		m_log.enqueue(entry);
+	}
+
+	std::size_t apu_worker::read_samples(std::span<std::int16_t> out) {
+		const auto wanted = out.size() / 2;
+		std::size_t frames = 0;
+
+		while (frames < wanted) {
+			if (m_chunk_pos == m_chunk.size()) {
+				m_chunk_pos = 0;
+				if (!m_output.try_dequeue(m_chunk)) {
+					m_chunk.clear();
+					break;
+				}
+				continue;
+			}
+
+			const auto count = (std::min)(wanted - frames, (m_chunk.size() - m_chunk_pos) / 2);
+			std::copy_n(m_chunk.begin() + m_chunk_pos, count * 2, out.begin() + frames * 2);
+			m_chunk_pos += count * 2;
+			frames += count;
+		}
+
+		m_available.fetch_sub(frames, std::memory_order_relaxed);
+		return frames;
+	}
+
+	std::size_t apu_worker::samples_available() const noexcept {
+		return m_available.load(std::memory_order_relaxed);
+	}
+
+	void apu_worker::wait_idle() {
+		const auto target = m_recorded.load(std::memory_order_relaxed);
+		auto replayed = m_replayed.load(std::memory_order_acquire);
+		while (replayed < target) {
+			m_replayed.wait(replayed, std::memory_order_acquire);
+			replayed = m_replayed.load(std::memory_order_acquire);
+		}
+	}
+
+	void apu_worker::publish() {
+		const auto frames = m_shadow->samples_available();
+		if (frames == 0) {
+			return;
+		}
+
+		std::vector<std::int16_t> chunk(frames * 2);
+		m_shadow->read_samples(chunk);
+		// counted first so the consumer never sees more frames than available
+		m_available.fetch_add(frames, std::memory_order_relaxed);
+		m_output.enqueue(std::move(chunk));
+	}
+
+	void apu_worker::run(std::stop_token stop) {
+		apu_log_entry entry{};
+		while (!stop.stop_requested()) {
+			if (!m_log.wait_dequeue_timed(entry, std::chrono::milliseconds(10))) {
+				continue;
+			}
+
+			m_shadow->replay(entry);
+			if (entry.addr == apu::sync_marker) {
+				publish();
+			}
+
+			m_replayed.fetch_add(1, std::memory_order_release);
+			if (m_log.size_approx() == 0) {
+				m_replayed.notify_all();
+			}
+		}
+	}
+
+}
@@ -0,0 +1,43 @@
+#include <algorithm>
+
+#include <yahbog/batch_runner.h>
+
+namespace yahbog {
+
+	batch_runner::batch_runner(const emulator& prototype, std::size_t count, std::size_t threads, bool pin_threads)
+		: m_buttons(count), m_cycles(count), m_frame_hashes(count), m_framebuffers(count * gpu::framebuffer_size),
+		m_pool(threads, pin_threads) {
+
+		m_instances.resize(count);
+		m_pool.parallel_for(count, [&](std::size_t i) {
+			m_instances[i] = prototype.clone();
+			m_instances[i]->spu.set_synthesis(false);
+			m_buttons[i] = m_instances[i]->pad.buttons();
+		});
+	}
+
+	template<typename Step>
+	void batch_runner::step_all(Step step) {
+		m_pool.parallel_for(m_instances.size(), [&](std::size_t i) {
+			auto& emu = *m_instances[i];
+			emu.set_buttons(m_buttons[i]);
+
+			m_cycles[i] = step(emu);
+
+			m_frame_hashes[i] = emu.ppu.frame_hash();
+			std::ranges::copy(emu.ppu.framebuffer(), m_framebuffers.begin() + i * gpu::framebuffer_size);
+		});
+	}
+
+	void batch_runner::run_frame() {
+		step_all([](emulator& emu) { return emu.run_frame(); });
+	}
+
+	void batch_runner::run_cycles(std::size_t cycles) {
+		step_all([cycles](emulator& emu) {
+			emu.run_cycles(cycles);
+			return cycles;
+		});
+	}
+
+}
@@ -0,0 +1,124 @@
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include <yahbog/vector_env.h>
+#include <yahbog_c.h>
+
+struct yahbog_vector_env {
+	yahbog::vector_env env;
+};
+
+namespace {
+	thread_local std::string last_error;
+
+	// Runs fn, turning exceptions into the last error
+	template<typename Fn>
+	int guarded(Fn&& fn) {
+		try {
+			fn();
+			return 0;
+		}
+		catch (const std::exception& e) {
+			last_error = e.what();
+		}
+		catch (...) {
+			last_error = "Unknown error";
+		}
+		return -1;
+	}
+
+	template<typename T>
+	std::span<T> buffer(T* data, std::size_t size, const char* what) {
+		if (!data && size != 0) {
+			throw std::invalid_argument(std::string("No buffer was given for ") + what);
+		}
+		return { data, size };
+	}
+}
+
+extern "C" {
+
+	yahbog_vector_env* yahbog_vector_env_create(const char* rom_path, const yahbog_env_config* config) {
+		yahbog_vector_env* created = nullptr;
+
+		guarded([&] {
+			if (!rom_path || !config) {
+				throw std::invalid_argument("A ROM path and a config are required");
+			}
+
+			auto prototype = std::make_unique<yahbog::emulator>();
+			if (!prototype->rom.load_rom(std::filesystem::path(rom_path))) {
+				throw std::runtime_error(std::string("Could not load ROM ") + rom_path);
+			}
+			prototype->reset();
+
+			if (config->start_state) {
+				prototype->load_state({ static_cast<const std::byte*>(config->start_state), config->start_state_size });
+			}
+
+			yahbog::vector_env_options options{
+				.envs = config->envs,
+				.threads = config->threads,
+				.pin_threads = config->pin_threads != 0,
+				.frame = config->frame != 0,
+				.max_episode_steps = config->max_episode_steps
+			};
+
+			for (std::size_t i = 0; i < config->ram_count; i++) {
+				options.ram.push_back({ config->ram[i].start, config->ram[i].length });
+			}
+
+			if (auto reward = config->reward) {
+				options.reward = [reward, user = config->user](std::size_t env, const yahbog::emulator&, std::span<const std::uint8_t> obs) {
+					return reward(user, env, obs.data(), obs.size());
+				};
+			}
+
+			if (auto done = config->done) {
+				options.done = [done, user = config->user](std::size_t env, const yahbog::emulator&, std::span<const std::uint8_t> obs) {
+					return done(user, env, obs.data(), obs.size()) != 0;
+				};
+			}
+
+			created = new yahbog_vector_env{ yahbog::vector_env(*prototype, std::move(options)) };
+		});
+
+		return created;
+	}
+
+	void yahbog_vector_env_destroy(yahbog_vector_env* env) {
+		delete env;
+	}
+
+	size_t yahbog_vector_env_size(const yahbog_vector_env* env) {
+		return env->env.size();
+	}
+
+	size_t yahbog_vector_env_observation_size(const yahbog_vector_env* env) {
+		return env->env.observation_size();
+	}
+
+	int yahbog_vector_env_reset(yahbog_vector_env* env, const uint8_t* mask, uint8_t* observations, size_t observations_size) {
+		return guarded([&] {
+			const auto n = env->env.size();
+			env->env.reset({ mask, mask ? n : 0 }, buffer(observations, observations_size, "observations"));
+		});
+	}
+
+	int yahbog_vector_env_step(yahbog_vector_env* env, const uint8_t* actions, uint8_t* observations, size_t observations_size, float* rewards, uint8_t* dones) {
+		return guarded([&] {
+			const auto n = env->env.size();
+			env->env.step(buffer(actions, n, "actions"), buffer(observations, observations_size, "observations"),
+				buffer(rewards, n, "rewards"), buffer(dones, n, "done flags"));
+		});
+	}
+
+	const char* yahbog_last_error(void) {
+		return last_error.c_str();
+	}
+
+}
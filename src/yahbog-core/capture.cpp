@@ -0,0 +1,241 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <format>
+#include <stdexcept>
+#include <string>
+
+#include <yahbog/capture.h>
+
+namespace yahbog {
+
+	static_assert(std::endian::native == std::endian::little, "PCM capture writes samples in host byte order");
+
+	namespace {
+		std::FILE* open_output(const std::filesystem::path& path) {
+			if (path == "-") {
+				return stdout;
+			}
+
+			std::FILE* file = std::fopen(path.string().c_str(), "wb");
+			if (!file) {
+				throw std::runtime_error(std::format("Could not open {} for capture", path.string()));
+			}
+			return file;
+		}
+
+		void close_output(std::FILE* file) {
+			if (file == stdout) {
+				std::fflush(file);
+			}
+			else if (file) {
+				std::fclose(file);
+			}
+		}
+
+		void put_le(std::uint8_t* out, std::uint32_t value, std::size_t bytes) {
+			for (std::size_t i = 0; i < bytes; i++) {
+				out[i] = static_cast<std::uint8_t>(value >> (i * 8));
+			}
+		}
+
+		// Sizes of 0xFFFFFFFF mark a stream of unknown length; they are patched on
+		// close when the output is seekable
+		std::array<std::uint8_t, 44> wav_header(std::uint32_t sample_rate) {
+			constexpr std::uint32_t channels = 2;
+			constexpr std::uint32_t bytes_per_frame = channels * sizeof(std::int16_t);
+
+			std::array<std::uint8_t, 44> h{ 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' };
+			put_le(&h[4], 0xFFFFFFFF, 4);
+			put_le(&h[16], 16, 4);
+			put_le(&h[20], 1, 2); // PCM
+			put_le(&h[22], channels, 2);
+			put_le(&h[24], sample_rate, 4);
+			put_le(&h[28], sample_rate * bytes_per_frame, 4);
+			put_le(&h[32], bytes_per_frame, 2);
+			put_le(&h[34], 16, 2);
+			h[36] = 'd'; h[37] = 'a'; h[38] = 't'; h[39] = 'a';
+			put_le(&h[40], 0xFFFFFFFF, 4);
+			return h;
+		}
+	}
+
+	capture::capture(const capture_options& options)
+		: m_options(options), m_queue(options.queue_chunks), m_recycled(options.queue_chunks) {
+
+		try {
+			if (!m_options.video.empty()) {
+				m_video = open_output(m_options.video);
+
+				const auto header = std::format("YUV4MPEG2 W{} H{} F{}:{} Ip A1:1 Cmono\n",
+					gpu::screen_width, gpu::screen_height, 4194304, gpu::dots_per_frame);
+				std::fwrite(header.data(), 1, header.size(), m_video);
+			}
+
+			if (!m_options.audio.empty()) {
+				m_audio = open_output(m_options.audio);
+
+				if (m_options.audio_format == audio_container::wav) {
+					const auto header = wav_header(m_options.sample_rate);
+					std::fwrite(header.data(), 1, header.size(), m_audio);
+				}
+			}
+		}
+		catch (...) {
+			close_output(m_video);
+			throw;
+		}
+
+		m_thread = std::jthread([this](std::stop_token stop) { run(stop); });
+	}
+
+	capture::~capture() {
+		close();
+	}
+
+	bool capture::push_frame(std::span<const std::uint8_t, gpu::framebuffer_size> frame) {
+		return push_frame(frame, m_options.deduplicate ? xxhash64_of(frame) : 0);
+	}
+
+	bool capture::push_frame(const gpu& ppu) {
+		std::span<const std::uint8_t, gpu::framebuffer_size> frame(ppu.framebuffer());
+		if (ppu.has_output()) {
+			// framebuffer() is not drawn while an output is registered
+			const auto& output = ppu.output();
+			if (output.format != pixel_format::packed_2bpp) {
+				throw std::invalid_argument("Capturing from a gpu needs its frame output to be packed 2bpp");
+			}
+
+			constexpr auto line_bytes = gpu::screen_width / 4;
+			const auto stride = output.stride ? output.stride : line_bytes;
+			const auto front = ppu.front_buffer();
+			for (std::size_t y = 0; y < gpu::screen_height; y++) {
+				std::ranges::copy(front.subspan(y * stride, line_bytes), m_frame.begin() + y * line_bytes);
+			}
+			frame = m_frame;
+		}
+
+		if (!ppu.frame_hashing()) {
+			// frame_hash() stopped following the frames when hashing was turned off
+			return push_frame(frame);
+		}
+		return push_frame(frame, ppu.frame_hash());
+	}
+
+	bool capture::push_frame(std::span<const std::uint8_t, gpu::framebuffer_size> frame, std::uint64_t hash) {
+		if (!m_video) {
+			return false;
+		}
+
+		if (m_options.deduplicate && m_has_last && hash == m_last_hash) {
+			m_frames_deduplicated++;
+			return true;
+		}
+
+		if (!enqueue(stream::video, frame)) {
+			return false;
+		}
+
+		// a dropped frame is not a repeat of the next one
+		m_has_last = m_options.deduplicate;
+		m_last_hash = hash;
+		return true;
+	}
+
+	bool capture::push_audio(std::span<const std::int16_t> samples) {
+		if (!m_audio || samples.empty()) {
+			return m_audio != nullptr;
+		}
+
+		const auto bytes = std::as_bytes(samples);
+		return enqueue(stream::audio, { reinterpret_cast<const std::uint8_t*>(bytes.data()), bytes.size() });
+	}
+
+	bool capture::push_audio(apu& source) {
+		m_scratch.resize(source.samples_available() * 2);
+		const auto frames = source.read_samples(m_scratch);
+		return push_audio(std::span<const std::int16_t>(m_scratch.data(), frames * 2));
+	}
+
+	bool capture::enqueue(stream target, std::span<const std::uint8_t> bytes) {
+		std::vector<std::uint8_t> buffer;
+		m_recycled.try_dequeue(buffer);
+		buffer.assign(bytes.begin(), bytes.end());
+
+		if (!m_queue.try_enqueue(chunk{ target, std::move(buffer) })) {
+			m_dropped++;
+			return false;
+		}
+		return true;
+	}
+
+	void capture::close() {
+		if (!m_thread.joinable()) {
+			return;
+		}
+
+		m_thread.request_stop();
+		m_thread.join();
+
+		close_output(m_video);
+		m_video = nullptr;
+
+		if (m_audio && m_options.audio_format == audio_container::wav && m_audio != stdout
+			&& m_audio_bytes + 36 <= 0xFFFFFFFF && std::fseek(m_audio, 4, SEEK_SET) == 0) {
+
+			std::array<std::uint8_t, 4> size{};
+			put_le(size.data(), static_cast<std::uint32_t>(m_audio_bytes + 36), 4);
+			std::fwrite(size.data(), 1, size.size(), m_audio);
+
+			if (std::fseek(m_audio, 40, SEEK_SET) == 0) {
+				put_le(size.data(), static_cast<std::uint32_t>(m_audio_bytes), 4);
+				std::fwrite(size.data(), 1, size.size(), m_audio);
+			}
+		}
+		close_output(m_audio);
+		m_audio = nullptr;
+	}
+
+	void capture::write(const chunk& c) {
+		if (c.target == stream::audio) {
+			std::fwrite(c.data.data(), 1, c.data.size(), m_audio);
+			m_audio_bytes += c.data.size();
+			return;
+		}
+
+		// packed shades, leftmost pixel in the high bits, to 8-bit luma
+		m_luma.resize(gpu::screen_width * gpu::screen_height);
+		for (std::size_t i = 0; i < c.data.size(); i++) {
+			for (std::size_t p = 0; p < 4; p++) {
+				const std::uint8_t shade = (c.data[i] >> (6 - p * 2)) & 3;
+				m_luma[i * 4 + p] = static_cast<std::uint8_t>(255 - shade * 85);
+			}
+		}
+
+		constexpr std::string_view frame_header = "FRAME\n";
+		std::fwrite(frame_header.data(), 1, frame_header.size(), m_video);
+		std::fwrite(m_luma.data(), 1, m_luma.size(), m_video);
+		m_frames_written++;
+	}
+
+	void capture::run(std::stop_token stop) {
+		chunk c{};
+		while (true) {
+			if (m_queue.wait_dequeue_timed(c, std::chrono::milliseconds(10))) {
+				write(c);
+				m_recycled.try_enqueue(std::move(c.data));
+				continue;
+			}
+
+			// stop only once everything queued before close() is on disk
+			if (stop.stop_requested()) {
+				while (m_queue.try_dequeue(c)) {
+					write(c);
+				}
+				break;
+			}
+		}
+	}
+
+}
@@ -1,4 +1,15 @@
 #pragma once
 
+#include <yahbog/apu_worker.h>
+#include <yahbog/batch_runner.h>
+#include <yahbog/capture.h>
 #include <yahbog/emulator.h>
-#include <yahbog/opinfo.h>
\ No newline at end of file
+#include <yahbog/lockstep.h>
+#include <yahbog/movie.h>
+#include <yahbog/opinfo.h>
+#include <yahbog/ppu_worker.h>
+#include <yahbog/ram_gather.h>
+#include <yahbog/resampler.h>
+#include <yahbog/rewind.h>
+#include <yahbog/thread_pool.h>
+#include <yahbog/vector_env.h>
\ No newline at end of file
@@ -2,13 +2,250 @@
 
 #include <yahbog/registers.h>
 #include <yahbog/mmu.h>
+#include <yahbog/utility/blip_buffer.h>
+
+#include <limits>
 
 namespace yahbog {
 
+	// A sound register or wave RAM write, stamped with the T-cycle it happened on
+	struct apu_log_entry {
+		std::uint64_t time;
+		std::uint16_t addr;
+		std::uint8_t value;
+	};
+
+	// Receives the writes of an APU whose samples are synthesized elsewhere
+	class deferred_synthesizer {
+	public:
+		virtual ~deferred_synthesizer() = default;
+
+		// Called on the emulation thread for every write, in order
+		virtual void record(const apu_log_entry& entry) = 0;
+	};
+
 	class apu {
 	public:
 
+		consteval static auto address_range() {
+			return std::array{
+				address_range_t<apu>{ 0xFF10, 0xFF2F, &apu::read_register, &apu::write_register },
+				address_range_t<apu>{ 0xFF30, 0xFF3F, &apu::read_wave, &apu::write_wave }
+			};
+		}
+
+		// Output rate of read_samples
+		constexpr static std::size_t sample_rate = 4194304 / blip_buffer::clocks_per_sample;
+
+		// Restores the post-boot register state of a DMG
+		constexpr void reset();
+
+		// clock counts machine cycles; the APU does no work until it is accessed
+		// through the bus or drained, and then catches up to *clock in one go
+		constexpr explicit apu(const std::size_t* clock = nullptr) noexcept : m_clock(clock) {}
+
+		constexpr void set_clock(const std::size_t* clock) noexcept { m_clock = clock; }
+
+		// Brings the channels and the frame sequencer up to the current cycle
+		constexpr void sync() {
+			if (m_clock) {
+				run_until(static_cast<std::uint64_t>(*m_clock) * 4);
+			}
+		}
+
+		// Without synthesis the channels still run, so the machine behaves the same,
+		// but their levels are not mixed and no samples are produced.
+		constexpr void set_synthesis(bool enabled);
+		constexpr bool synthesis() const noexcept { return m_synthesis; }
+
+		// Log addresses that are not registers: run up to the entry's time, and
+		// return to the post-boot state
+		constexpr static std::uint16_t sync_marker = 0x0000;
+		constexpr static std::uint16_t reset_marker = 0x0001;
+
+		// While deferred, the registers are still emulated here without synthesis
+		// and every write is forwarded to synth. Detaching turns synthesis back on.
+		constexpr void defer_synthesis(deferred_synthesizer* synth) {
+			sync();
+			m_deferred = synth;
+			set_synthesis(synth == nullptr);
+		}
+		constexpr bool synthesis_deferred() const { return m_deferred != nullptr; }
+
+		// Tells the deferred synthesizer that samples up to now can be produced
+		constexpr void flush() {
+			sync();
+			if (m_deferred) {
+				m_deferred->record({ m_time, sync_marker, 0 });
+			}
+		}
+
+		// Applies a logged entry to an APU that has no clock of its own
+		constexpr void replay(const apu_log_entry& entry);
+
+		// Channel, frame sequencer and sample buffer state. Whether synthesis is on
+		// is host configuration: a state saved without it starts with empty sample
+		// buffers when loaded with it.
+		template<typename IO>
+		void serialize(IO& io) {
+			if constexpr (!IO::loading) {
+				sync();
+			}
+
+			io(m_regs);
+			io(m_wave_ram);
+
+			if constexpr (IO::emulated_only) {
+				// field by field, leaving out the amplitudes in the sample buffers
+				for (const auto& c : m_channels) {
+					io(c.enabled);
+					io(c.dac);
+					io(c.length);
+					io(c.length_enable);
+					io(c.frequency);
+					io(c.next_step);
+					io(c.volume);
+					io(c.env_period);
+					io(c.env_timer);
+					io(c.env_up);
+					io(c.position);
+				}
+				io(m_sweep.enabled);
+				io(m_sweep.shadow);
+				io(m_sweep.timer);
+				io(m_sweep.negate_used);
+			}
+			else {
+				io(m_channels);
+				io(m_sweep);
+			}
+
+			io(m_power);
+			io(m_fs_step);
+			io(m_fs_next);
+			io(m_time);
+
+			if constexpr (IO::emulated_only) {
+				return;
+			}
+
+			bool synthesized = m_synthesis;
+			io.layout(synthesized);
+			if (synthesized) {
+				m_left.serialize(io, m_time);
+				m_right.serialize(io, m_time);
+			}
+
+			if constexpr (IO::loading) {
+				if (m_synthesis != synthesized) {
+					restart_synthesis();
+				}
+			}
+		}
+
+		// Stereo frames that can be read right now
+		constexpr std::size_t samples_available() {
+			sync();
+			return m_synthesis ? m_left.samples_ready(m_time) : 0;
+		}
+
+		// Reads up to out.size() / 2 interleaved left/right frames at sample_rate
+		// and returns the number of frames written
+		constexpr std::size_t read_samples(std::span<std::int16_t> out);
+
 	private:
+
+		friend class apu_worker;
+
+		constexpr uint8_t read_register(uint16_t addr);
+		constexpr void write_register(uint16_t addr, uint8_t value);
+		constexpr uint8_t read_wave(uint16_t addr);
+		constexpr void write_wave(uint16_t addr, uint8_t value);
+
+		enum channel_id : std::uint8_t {
+			square1 = 0,
+			square2 = 1,
+			wave = 2,
+			noise = 3
+		};
+
+		struct channel_t {
+			bool enabled = false;
+			bool dac = false;
+
+			std::uint16_t length = 0;
+			bool length_enable = false;
+
+			std::uint16_t frequency = 0;
+			// absolute T-cycle of the next waveform step
+			std::uint64_t next_step = never;
+
+			// envelope (square and noise)
+			std::uint8_t volume = 0;
+			std::uint8_t env_period = 0;
+			std::uint8_t env_timer = 0;
+			bool env_up = false;
+
+			// waveform position: duty step, wave sample index or LFSR
+			std::uint16_t position = 0;
+
+			// amplitudes currently in the left and right delta buffers
+			std::int32_t amp_left = 0;
+			std::int32_t amp_right = 0;
+		};
+
+		struct sweep_t {
+			bool enabled = false;
+			std::uint16_t shadow = 0;
+			std::uint8_t timer = 0;
+			bool negate_used = false;
+		};
+
+		constexpr static std::uint64_t never = (std::numeric_limits<std::uint64_t>::max)();
+		constexpr static std::uint64_t frame_sequencer_period = 8192;
+		constexpr static std::int32_t volume_unit = 64;
+
+		constexpr std::uint8_t& reg(std::uint16_t addr) { return m_regs[addr - 0xFF10]; }
+		constexpr std::uint8_t reg(std::uint16_t addr) const { return m_regs[addr - 0xFF10]; }
+
+		constexpr void run_until(std::uint64_t time);
+		constexpr void run_channel(channel_id id, std::uint64_t end);
+		constexpr void step_channel(channel_id id);
+		constexpr void clock_frame_sequencer();
+
+		constexpr std::uint64_t period(channel_id id) const;
+		constexpr std::uint8_t digital_output(channel_id id) const;
+		constexpr void update_output(channel_id id, std::uint64_t time);
+		constexpr void update_all_outputs(std::uint64_t time);
+
+		constexpr void trigger(channel_id id);
+		constexpr void write_length_control(channel_id id, std::uint8_t value);
+		constexpr std::uint16_t sweep_calculate();
+		constexpr void power_off();
+		constexpr void restart_synthesis();
+
+		std::array<std::uint8_t, 0x20> m_regs{};
+		std::array<std::uint8_t, 0x10> m_wave_ram{};
+		std::array<channel_t, 4> m_channels{};
+		sweep_t m_sweep{};
+
+		bool m_power = false;
+		bool m_synthesis = true;
+
+		// step that the frame sequencer performs next, and when
+		std::uint8_t m_fs_step = 0;
+		std::uint64_t m_fs_next = frame_sequencer_period;
+
+		// T-cycles emulated so far
+		std::uint64_t m_time = 0;
+		const std::size_t* m_clock = nullptr;
+
+		deferred_synthesizer* m_deferred = nullptr;
+
+		blip_buffer m_left{};
+		blip_buffer m_right{};
 	};
 
-}
\ No newline at end of file
+}
+
+#include <yahbog/impl/apu_impl.h>
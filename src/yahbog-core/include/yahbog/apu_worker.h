@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <readerwriterqueue.h>
+
+#include <yahbog/apu.h>
+
+namespace yahbog {
+
+	// Synthesizes audio on a second thread. While attached, the APU keeps only its
+	// register semantics and streams timestamped writes through a lock-free queue;
+	// the worker replays them against its own APU. Samples are produced up to each
+	// apu::flush(), and are bit-identical to draining the APU inline at the same
+	// points.
+	class apu_worker final : public deferred_synthesizer {
+	public:
+		// Attaches to source, which must outlive the worker
+		explicit apu_worker(apu& source);
+		~apu_worker() override;
+
+		apu_worker(const apu_worker&) = delete;
+		apu_worker& operator=(const apu_worker&) = delete;
+
+		void record(const apu_log_entry& entry) override;
+
+		// Reads up to out.size() / 2 interleaved left/right frames that have been
+		// synthesized so far. Never blocks; safe to call from one consumer thread,
+		// such as an audio callback.
+		std::size_t read_samples(std::span<std::int16_t> out);
+
+		// Frames that read_samples can return right now
+		std::size_t samples_available() const noexcept;
+
+		// Blocks until every recorded entry has been replayed
+		void wait_idle();
+
+	private:
+		void run(std::stop_token stop);
+		void publish();
+
+		apu& m_source;
+		std::unique_ptr<apu> m_shadow;
+
+		moodycamel::BlockingReaderWriterQueue<apu_log_entry> m_log{ 4096 };
+		moodycamel::ReaderWriterQueue<std::vector<std::int16_t>> m_output{ 64 };
+
+		// consumer side: the chunk being read and how far into it
+		std::vector<std::int16_t> m_chunk;
+		std::size_t m_chunk_pos = 0;
+
+		std::atomic<std::size_t> m_available = 0;
+		std::atomic<std::uint64_t> m_recorded = 0;
+		std::atomic<std::uint64_t> m_replayed = 0;
+
+		std::jthread m_thread;
+	};
+
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <yahbog/emulator.h>
+#include <yahbog/thread_pool.h>
+
+namespace yahbog {
+
+	// Steps many independent emulators together on a thread_pool. Inputs and
+	// outputs are flat arrays indexed by instance, so callers can fill and read
+	// them without touching the emulators.
+	class batch_runner {
+	public:
+		// Starts count instances, each a clone of prototype sharing its ROM image,
+		// with audio synthesis off; turn it back on per instance to read samples.
+		// threads and pin_threads are passed to the thread_pool.
+		batch_runner(const emulator& prototype, std::size_t count, std::size_t threads = 0, bool pin_threads = false);
+
+		std::size_t size() const noexcept { return m_instances.size(); }
+		emulator& operator[](std::size_t i) { return *m_instances[i]; }
+
+		// Pressed buttons per instance (masks of button::*), applied at the start
+		// of every step
+		std::span<std::uint8_t> buttons() noexcept { return m_buttons; }
+
+		// Machine cycles each instance ran in the last step
+		std::span<const std::size_t> cycles() const noexcept { return m_cycles; }
+
+		// gpu::frame_hash of each instance after the last step
+		std::span<const std::uint64_t> frame_hashes() const noexcept { return m_frame_hashes; }
+
+		// Packed 2bpp framebuffers after the last step, gpu::framebuffer_size
+		// bytes per instance
+		std::span<const std::uint8_t> framebuffers() const noexcept { return m_framebuffers; }
+
+		// Runs one frame on every instance
+		void run_frame();
+
+		// Runs the given number of machine cycles on every instance
+		void run_cycles(std::size_t cycles);
+
+		thread_pool& pool() noexcept { return m_pool; }
+
+	private:
+		// Applies the buttons, runs step on instance i and collects its outputs
+		template<typename Step>
+		void step_all(Step step);
+
+		std::vector<std::unique_ptr<emulator>> m_instances;
+
+		std::vector<std::uint8_t> m_buttons;
+		std::vector<std::size_t> m_cycles;
+		std::vector<std::uint64_t> m_frame_hashes;
+		std::vector<std::uint8_t> m_framebuffers;
+
+		thread_pool m_pool;
+	};
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <readerwritercircularbuffer.h>
+#include <readerwriterqueue.h>
+
+#include <yahbog/apu.h>
+#include <yahbog/ppu.h>
+
+namespace yahbog {
+
+	enum class audio_container : std::uint8_t {
+		wav,
+		raw // interleaved little-endian int16, no header
+	};
+
+	struct capture_options {
+		// Y4M (mono luma) output; empty to skip video. FIFOs work, and "-" is stdout.
+		std::filesystem::path video;
+
+		// PCM output; empty to skip audio
+		std::filesystem::path audio;
+		audio_container audio_format = audio_container::wav;
+		std::uint32_t sample_rate = apu::sample_rate;
+
+		// Skip frames whose hash equals the previous frame's
+		bool deduplicate = false;
+
+		// Chunks that may be queued for the writer before pushes start dropping
+		std::size_t queue_chunks = 256;
+	};
+
+	// Streams frames and samples to disk or a pipe from a writer thread. Pushing
+	// only copies into a bounded queue; when the writer falls behind, pushes are
+	// dropped and counted instead of blocking the emulation thread.
+	class capture {
+	public:
+		// Throws std::runtime_error if an output cannot be opened
+		explicit capture(const capture_options& options);
+		~capture();
+
+		capture(const capture&) = delete;
+		capture& operator=(const capture&) = delete;
+
+		// Queues one frame of packed 2bpp shades. Returns false if it was dropped.
+		bool push_frame(std::span<const std::uint8_t, gpu::framebuffer_size> frame);
+
+		// Queues the gpu's last completed frame, reusing its frame hash for
+		// deduplication while frame hashing is on. With a frame_output registered
+		// the frame is read from its front buffer; throws std::invalid_argument if
+		// that output is not packed 2bpp.
+		bool push_frame(const gpu& ppu);
+
+		// Queues interleaved left/right frames. Returns false if they were dropped.
+		bool push_audio(std::span<const std::int16_t> samples);
+
+		// Drains everything the APU has synthesized so far
+		bool push_audio(apu& source);
+
+		// Waits for queued data to be written and finalizes the headers
+		void close();
+
+		std::size_t frames_written() const noexcept { return m_frames_written; }
+		std::size_t frames_deduplicated() const noexcept { return m_frames_deduplicated; }
+		std::size_t chunks_dropped() const noexcept { return m_dropped; }
+
+	private:
+		enum class stream : std::uint8_t { video, audio };
+
+		struct chunk {
+			stream target;
+			std::vector<std::uint8_t> data;
+		};
+
+		bool push_frame(std::span<const std::uint8_t, gpu::framebuffer_size> frame, std::uint64_t hash);
+		bool enqueue(stream target, std::span<const std::uint8_t> bytes);
+		void run(std::stop_token stop);
+		void write(const chunk& c);
+
+		capture_options m_options;
+
+		std::FILE* m_video = nullptr;
+		std::FILE* m_audio = nullptr;
+		std::uint64_t m_audio_bytes = 0;
+
+		bool m_has_last = false;
+		std::uint64_t m_last_hash = 0;
+
+		moodycamel::BlockingReaderWriterCircularBuffer<chunk> m_queue;
+		// buffers handed back by the writer so pushes do not allocate
+		moodycamel::ReaderWriterQueue<std::vector<std::uint8_t>> m_recycled;
+
+		std::vector<std::int16_t> m_scratch;
+		gpu::framebuffer_t m_frame{};
+		std::vector<std::uint8_t> m_luma;
+
+		std::atomic<std::size_t> m_frames_written = 0;
+		std::size_t m_frames_deduplicated = 0;
+		std::size_t m_dropped = 0;
+
+		std::jthread m_thread;
+	};
+
+}
@@ -25,10 +25,9 @@ namespace yahbog {
 		constexpr cpu(read_fn_t* read, write_fn_t* write) noexcept : mem_fns{ read, write } {}
 
 		constexpr void reset() noexcept {
-			reg.pc = 0x100;
-			reg.sp = 0xFFFE;
+			reg = registers{};
+			reg.reset();
 			reg.ime = 0;
-			reg.mupc = 0;
 			m_cycles = 0;
 
 			div = 0x00;
@@ -115,14 +114,34 @@ namespace yahbog {
 			m_cycles++;
 		}
 
+		// ORs the given IF mask into the interrupt flags
+		constexpr void request_interrupt(std::uint8_t mask) noexcept {
+			if_.write(if_.read() | mask);
+		}
+
 		constexpr auto& r() const noexcept { return reg; }
 		constexpr auto cycles() const noexcept { return m_cycles; }
+		constexpr const std::size_t* cycle_counter() const noexcept { return &m_cycles; }
 
 		constexpr void load_registers(const registers& r) noexcept { 
 			reg = r; 
 			reg.ir &= 0x1FF;
 		}
 
+		// Registers (including the micro-op position of the current instruction),
+		// cycle count, timers and interrupt flags
+		template<typename IO>
+		void serialize(IO& io) {
+			io(m_cycles);
+			io(reg);
+			io(div);
+			io(tima);
+			io(tma);
+			io(tac);
+			io(ie);
+			io(if_);
+		}
+
 		constexpr void set_reader(read_fn_t& read) noexcept { mem_fns.read_ = &read; }
 		constexpr void set_writer(write_fn_t& write) noexcept { mem_fns.write_ = &write; }
 
@@ -2,13 +2,17 @@
 
 #include <vector>
 #include <filesystem>
+#include <memory>
 #include <span>
 #include <variant>
 
 #include <yahbog/mmu.h>
 #include <yahbog/cpu.h>
 #include <yahbog/ppu.h>
+#include <yahbog/apu.h>
+#include <yahbog/joypad.h>
 #include <yahbog/rom.h>
+#include <yahbog/savestate.h>
 
 namespace yahbog {
 
@@ -32,6 +36,11 @@ namespace yahbog {
 
 		constexpr wram_t() : wram{0} {}
 
+		template<typename IO>
+		void serialize(IO& io) {
+			io(wram);
+		}
+
 		std::array<uint8_t, 0x2000> wram;
 	};
 
@@ -47,21 +56,123 @@ namespace yahbog {
 		rom_t rom;
 		cpu z80;
 		gpu ppu;
+		apu spu;
+		joypad pad;
 
-		memory_dispatcher<0x10000, gpu, wram_t, hram_t, rom_t, cpu> mmu;
+		memory_dispatcher<0x10000, gpu, apu, wram_t, hram_t, rom_t, cpu, joypad> mmu;
 
 		constexpr emulator() : 
 			reader(default_reader()),
 			writer(default_writer()),
 			z80(&reader, &writer),
-			ppu(&reader, &writer)
+			ppu(&reader, &writer),
+			spu(z80.cycle_counter())
 			{
 				mmu.set_handler(&wram);
 				mmu.set_handler(&hram);
 				mmu.set_handler(&ppu);
+				mmu.set_handler(&spu);
 				mmu.set_handler(&rom);
 				mmu.set_handler(&z80);
+				mmu.set_handler(&pad);
+			}
+
+		// Machine cycles (1.048576 MHz) in one 59.7 Hz frame
+		constexpr static std::size_t cycles_per_frame = gpu::dots_per_frame / 4;
+
+		// Restores the post-boot state of a DMG, keeping the loaded ROM
+		constexpr void reset() noexcept {
+			z80.reset();
+			ppu.reset();
+			spu.reset();
+			pad.reset();
+		}
+
+		// Sets the pressed buttons (a mask of button::*) from now on
+		constexpr void set_buttons(std::uint8_t pressed) noexcept {
+			if (auto requested = pad.set_buttons(pressed)) {
+				z80.request_interrupt(requested);
+			}
+		}
+
+		// Advances the CPU and the PPU together by one machine cycle
+		constexpr void tick() {
+			z80.cycle();
+			if (auto requested = ppu.tick(4)) {
+				z80.request_interrupt(requested);
 			}
+		}
+
+		constexpr void run_cycles(std::size_t cycles) {
+			for (std::size_t i = 0; i < cycles; i++) {
+				tick();
+			}
+		}
+
+		// Runs until the PPU completes a frame and returns the number of machine
+		// cycles executed. With the LCD off this runs for one frame's worth of cycles.
+		constexpr std::size_t run_frame() {
+			const auto target = ppu.frames() + 1;
+			std::size_t executed = 0;
+			while (ppu.frames() < target && executed < cycles_per_frame) {
+				tick();
+				executed++;
+			}
+			return executed;
+		}
+
+		// Where an address is backed by plain memory rather than a register. The
+		// echo of WRAM at 0xE000 counts as WRAM. open_bus covers the holes that no
+		// handler claims, such as 0xFEA0-0xFEFF and 0xFF4C-0xFF7F.
+		enum class memory_region : std::uint8_t { bus, wram, hram, vram, oam, ext_ram, open_bus };
+
+		struct memory_run {
+			memory_region region;
+			std::uint16_t offset; // into the region's storage
+			std::uint16_t length; // bytes from the address to the end of the region
+		};
+
+		constexpr static memory_run memory_run_at(std::uint16_t addr);
+
+		// The bytes behind a region, empty for bus and for disabled external RAM
+		constexpr std::span<const std::uint8_t> region_storage(memory_region region);
+
+		// Reads out.size() bytes starting at addr as the bus would, copying runs
+		// of RAM, VRAM and OAM whole and dispatching only the registers in between.
+		// Open bus reads as 0xFF instead of throwing like mmu.read. Throws
+		// std::out_of_range if the span leaves the address space.
+		constexpr void peek_span(std::uint16_t addr, std::span<std::uint8_t> out);
+
+		// Writes in starting at addr as the bus would. Runs of WRAM, HRAM and
+		// external RAM are copied whole; VRAM, OAM and registers are written per
+		// byte so renderers and side effects see them. Writes to open bus are
+		// dropped. Throws like peek_span.
+		constexpr void poke_span(std::uint16_t addr, std::span<const std::uint8_t> in);
+
+		// Bytes that save_state needs for the current state
+		std::size_t state_size();
+
+		// Writes a snapshot into out and returns its size. Throws std::out_of_range
+		// if out is too small.
+		std::size_t save_state(std::span<std::byte> out);
+
+		// Restores a snapshot taken with the same ROM loaded. Throws
+		// std::invalid_argument if in is not a savestate of this version or of this
+		// ROM, or if its body does not match its size, and std::logic_error while
+		// rendering or synthesis is deferred. The state is checked before anything
+		// is loaded, so a refused state leaves the emulator as it was.
+		void load_state(std::span<const std::byte> in);
+
+		// XXH64 of the emulated state: a savestate without the sample buffers,
+		// the framebuffer and frame hashes, which depend on how the host drains
+		// and renders. Emulators that ran the same inputs from the same state hash
+		// the same.
+		std::uint64_t state_hash();
+
+		// A new emulator in the same state that shares this one's ROM image. Hooks,
+		// registered frame outputs and deferred rendering or synthesis stay with
+		// this instance; a clone of a deferred APU restarts its waveforms.
+		std::unique_ptr<emulator> clone() const;
 
 		constexpr read_fn_t default_reader() noexcept {
 			return [this](std::uint16_t addr) { return mmu.read(addr); };
@@ -94,8 +205,21 @@ namespace yahbog {
 
 	private:
 
+		template<typename IO>
+		void serialize(IO& io) {
+			z80.serialize(io);
+			ppu.serialize(io);
+			wram.serialize(io);
+			hram.serialize(io);
+			pad.serialize(io);
+			rom.serialize(io);
+			// after the CPU, whose cycle counter is the APU's clock
+			spu.serialize(io);
+		}
 	};
 
 	constexpr static auto emu_size = sizeof(emulator);
 
-}
\ No newline at end of file
+}
+
+#include <yahbog/impl/emulator_impl.h>
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace yahbog {
+
+	enum class pixel_format : std::uint8_t {
+		// four shades per byte, leftmost pixel in the high bits
+		packed_2bpp,
+		// one byte per pixel, mapped through output_palette::indices
+		indexed8,
+		// R, G, B, A bytes in memory order
+		rgba8888,
+		// B, G, R, A bytes in memory order
+		bgra8888
+	};
+
+	constexpr std::size_t bytes_per_pixel_line(pixel_format format, std::size_t width) {
+		switch (format) {
+		case pixel_format::packed_2bpp: return width / 4;
+		case pixel_format::indexed8: return width;
+		case pixel_format::rgba8888: return width * 4;
+		case pixel_format::bgra8888: return width * 4;
+		}
+		return 0;
+	}
+
+	// Maps the four DMG shades (0 is the lightest) to output values
+	struct output_palette {
+		struct rgba_t {
+			std::uint8_t r, g, b, a;
+		};
+
+		std::array<rgba_t, 4> colors{ {
+			{ 0xFF, 0xFF, 0xFF, 0xFF },
+			{ 0xAA, 0xAA, 0xAA, 0xFF },
+			{ 0x55, 0x55, 0x55, 0xFF },
+			{ 0x00, 0x00, 0x00, 0xFF }
+		} };
+
+		std::array<std::uint8_t, 4> indices{ 0, 1, 2, 3 };
+	};
+
+	// Caller-owned destination for completed frames. The PPU draws each line
+	// straight into the back buffer and swaps the two when a frame completes;
+	// leave the second buffer empty for single buffering.
+	struct frame_output {
+		pixel_format format = pixel_format::packed_2bpp;
+		std::array<std::span<std::uint8_t>, 2> buffers{};
+		output_palette palette{};
+
+		// bytes between the start of two lines, 0 for tightly packed lines
+		std::size_t stride = 0;
+	};
+
+}
@@ -0,0 +1,613 @@
+#pragma once
+
+#include <yahbog/apu.h>
+#include <algorithm>
+
+namespace yahbog {
+
+	namespace detail {
+		// bits that always read back as 1, indexed from 0xFF10
+		constexpr std::array<std::uint8_t, 0x20> apu_read_masks{
+			0x80, 0x3F, 0x00, 0xFF, 0xBF, // NR10-NR14
+			0xFF, 0x3F, 0x00, 0xFF, 0xBF, // NR20-NR24
+			0x7F, 0xFF, 0x9F, 0xFF, 0xBF, // NR30-NR34
+			0xFF, 0xFF, 0x00, 0x00, 0xBF, // NR40-NR44
+			0x00, 0x00, 0x70,             // NR50-NR52
+			0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+		};
+
+		// waveform of each duty setting, step 0 in the high bit
+		constexpr std::array<std::uint8_t, 4> duty_patterns{ 0b00000001, 0b10000001, 0b10000111, 0b01111110 };
+
+		// One step of the noise LFSR; the 7-bit mode also feeds the new bit into bit 6
+		constexpr std::uint16_t lfsr_step(std::uint16_t lfsr, bool narrow) {
+			const std::uint16_t bit = (lfsr ^ (lfsr >> 1)) & 1;
+			lfsr = static_cast<std::uint16_t>((lfsr >> 1) | (bit << 14));
+			if (narrow) {
+				lfsr = static_cast<std::uint16_t>((lfsr & ~0x40) | (bit << 6));
+			}
+			return lfsr;
+		}
+
+		// Stepping the LFSR is linear over GF(2), so any number of steps is a 15x15
+		// bit matrix, stored as the image of each bit
+		using lfsr_matrix = std::array<std::uint16_t, 15>;
+
+		constexpr std::uint16_t lfsr_apply(const lfsr_matrix& m, std::uint16_t lfsr) {
+			std::uint16_t result = 0;
+			for (std::size_t i = 0; i < m.size(); ++i) {
+				if ((lfsr >> i) & 1) {
+					result ^= m[i];
+				}
+			}
+			return result;
+		}
+
+		// lfsr_jumps[narrow][k] takes 2^k steps
+		constexpr auto lfsr_jumps = [] {
+			std::array<std::array<lfsr_matrix, 64>, 2> jumps{};
+			for (std::size_t narrow = 0; narrow < 2; ++narrow) {
+				for (std::size_t i = 0; i < 15; ++i) {
+					jumps[narrow][0][i] = lfsr_step(static_cast<std::uint16_t>(1u << i), narrow);
+				}
+				for (std::size_t k = 1; k < 64; ++k) {
+					for (std::size_t i = 0; i < 15; ++i) {
+						jumps[narrow][k][i] = lfsr_apply(jumps[narrow][k - 1], jumps[narrow][k - 1][i]);
+					}
+				}
+			}
+			return jumps;
+		}();
+
+		constexpr std::uint16_t lfsr_skip(std::uint16_t lfsr, std::uint64_t steps, bool narrow) {
+			for (std::size_t k = 0; steps; ++k, steps >>= 1) {
+				if (steps & 1) {
+					lfsr = lfsr_apply(lfsr_jumps[narrow][k], lfsr);
+				}
+			}
+			return lfsr;
+		}
+
+		static_assert([] {
+			for (bool narrow : { false, true }) {
+				std::uint16_t lfsr = 0x7FFF;
+				for (int i = 0; i < 1234; ++i) {
+					lfsr = lfsr_step(lfsr, narrow);
+				}
+				if (lfsr_skip(0x7FFF, 1234, narrow) != lfsr) {
+					return false;
+				}
+			}
+			return true;
+		}());
+	}
+
+	constexpr void apu::reset() {
+		m_time = 0;
+		m_left.clear(0);
+		m_right.clear(0);
+
+		m_channels = {};
+		m_sweep = {};
+		m_power = true;
+		m_fs_step = 0;
+		m_fs_next = frame_sequencer_period;
+
+		constexpr std::array<std::uint8_t, 0x17> post_boot{
+			0x80, 0xBF, 0xF3, 0xFF, 0xBF,
+			0xFF, 0x3F, 0x00, 0xFF, 0xBF,
+			0x7F, 0xFF, 0x9F, 0xFF, 0xBF,
+			0xFF, 0xFF, 0x00, 0x00, 0xBF,
+			0x77, 0xF3, 0xF1
+		};
+		std::copy(post_boot.begin(), post_boot.end(), m_regs.begin());
+
+		// the boot ROM leaves channel 1 running with its envelope decayed to silence
+		m_channels[square1].dac = true;
+		m_channels[square1].enabled = true;
+		m_channels[square1].frequency = 0x7FF;
+		m_channels[wave].frequency = 0x7FF;
+
+		if (m_deferred) {
+			m_deferred->record({ 0, reset_marker, 0 });
+		}
+	}
+
+	constexpr void apu::replay(const apu_log_entry& entry) {
+		if (entry.addr == reset_marker) {
+			reset();
+			return;
+		}
+
+		run_until(entry.time);
+
+		if (entry.addr >= 0xFF30) {
+			write_wave(entry.addr, entry.value);
+		}
+		else if (entry.addr >= 0xFF10) {
+			write_register(entry.addr, entry.value);
+		}
+	}
+
+	constexpr void apu::set_synthesis(bool enabled) {
+		sync();
+		if (enabled == m_synthesis) {
+			return;
+		}
+
+		m_synthesis = enabled;
+		restart_synthesis();
+	}
+
+	// The channels keep running while synthesis is off, so only the buffers and
+	// the amplitudes in them start over
+	constexpr void apu::restart_synthesis() {
+		m_left.clear(m_time);
+		m_right.clear(m_time);
+
+		for (auto& c : m_channels) {
+			c.amp_left = 0;
+			c.amp_right = 0;
+		}
+		update_all_outputs(m_time);
+	}
+
+	constexpr std::size_t apu::read_samples(std::span<std::int16_t> out) {
+		const auto frames = (std::min)(out.size() / 2, samples_available());
+		m_left.read(out, frames, 2);
+		m_right.read(out.subspan(1), frames, 2);
+		return frames;
+	}
+
+	constexpr void apu::run_until(std::uint64_t time) {
+		while (m_time < time) {
+			// nobody is draining the buffers, so drop what is ready rather than overflow;
+			// only once they are full, so the buffers do not depend on how often
+			// the APU was synced
+			if (m_synthesis && m_time >= m_left.room_until()) {
+				const auto ready = m_left.samples_ready(m_time);
+				m_left.discard(ready);
+				m_right.discard(ready);
+			}
+
+			const auto end = m_synthesis ? (std::min)(time, m_left.room_until()) : time;
+
+			while (m_power && m_fs_next <= end) {
+				for (auto id : { square1, square2, wave, noise }) {
+					run_channel(id, m_fs_next);
+				}
+				m_time = m_fs_next;
+				clock_frame_sequencer();
+			}
+
+			for (auto id : { square1, square2, wave, noise }) {
+				run_channel(id, end);
+			}
+			m_time = end;
+		}
+	}
+
+	// Steps the waveform of a channel through every event before end
+	constexpr void apu::run_channel(channel_id id, std::uint64_t end) {
+		auto& c = m_channels[id];
+		if (!c.enabled) {
+			return;
+		}
+
+		// with no output to update, skip to the position at end in one go
+		if (!m_synthesis) {
+			if (c.next_step < end) {
+				const auto p = period(id);
+				const auto steps = (end - c.next_step + p - 1) / p;
+				switch (id) {
+				case square1:
+				case square2:
+					c.position = static_cast<std::uint16_t>((c.position + steps) & 7);
+					break;
+				case wave:
+					c.position = static_cast<std::uint16_t>((c.position + steps) & 31);
+					break;
+				case noise:
+					c.position = detail::lfsr_skip(c.position, steps, reg(0xFF22) & 0x08);
+					break;
+				}
+				c.next_step += steps * p;
+			}
+			return;
+		}
+
+		while (c.next_step < end) {
+			const auto t = c.next_step;
+			step_channel(id);
+			update_output(id, t);
+
+			const auto p = period(id);
+			c.next_step = p == never ? never : t + p;
+		}
+	}
+
+	constexpr void apu::step_channel(channel_id id) {
+		auto& c = m_channels[id];
+		switch (id) {
+		case square1:
+		case square2:
+			c.position = (c.position + 1) & 7;
+			break;
+		case wave:
+			c.position = (c.position + 1) & 31;
+			break;
+		case noise:
+			c.position = detail::lfsr_step(c.position, reg(0xFF22) & 0x08);
+			break;
+		}
+	}
+
+	constexpr void apu::clock_frame_sequencer() {
+		const auto step = m_fs_step;
+
+		if ((step & 1) == 0) {
+			for (auto& c : m_channels) {
+				if (c.length_enable && c.length > 0) {
+					if (--c.length == 0) {
+						c.enabled = false;
+					}
+				}
+			}
+		}
+
+		if (step == 2 || step == 6) {
+			const std::uint8_t nr10 = reg(0xFF10);
+			const std::uint8_t sweep_period = (nr10 >> 4) & 7;
+
+			if (m_sweep.timer > 0) {
+				m_sweep.timer--;
+			}
+
+			if (m_sweep.timer == 0) {
+				m_sweep.timer = sweep_period ? sweep_period : 8;
+
+				if (m_sweep.enabled && sweep_period) {
+					const auto frequency = sweep_calculate();
+					if (frequency <= 2047 && (nr10 & 7)) {
+						m_sweep.shadow = frequency;
+						m_channels[square1].frequency = frequency;
+						reg(0xFF13) = frequency & 0xFF;
+						reg(0xFF14) = static_cast<std::uint8_t>((reg(0xFF14) & 0xF8) | (frequency >> 8));
+						sweep_calculate();
+					}
+				}
+			}
+		}
+
+		if (step == 7) {
+			for (auto id : { square1, square2, noise }) {
+				auto& c = m_channels[id];
+				if (c.env_period == 0) {
+					continue;
+				}
+
+				if (c.env_timer > 0) {
+					c.env_timer--;
+				}
+
+				if (c.env_timer == 0) {
+					c.env_timer = c.env_period;
+					if (c.env_up && c.volume < 15) {
+						c.volume++;
+					}
+					else if (!c.env_up && c.volume > 0) {
+						c.volume--;
+					}
+				}
+			}
+		}
+
+		update_all_outputs(m_time);
+
+		m_fs_step = (step + 1) & 7;
+		m_fs_next += frame_sequencer_period;
+	}
+
+	constexpr std::uint64_t apu::period(channel_id id) const {
+		const auto& c = m_channels[id];
+		switch (id) {
+		case square1:
+		case square2:
+			return (2048 - c.frequency) * 4;
+		case wave:
+			return (2048 - c.frequency) * 2;
+		case noise: {
+			const std::uint8_t nr43 = reg(0xFF22);
+			const std::uint8_t shift = nr43 >> 4;
+			if (shift >= 14) {
+				return never;
+			}
+			const std::uint64_t divisor = (nr43 & 7) ? (nr43 & 7) * 16 : 8;
+			return divisor << shift;
+		}
+		}
+		return never;
+	}
+
+	constexpr std::uint8_t apu::digital_output(channel_id id) const {
+		const auto& c = m_channels[id];
+		if (!c.enabled || !c.dac) {
+			return 0;
+		}
+
+		switch (id) {
+		case square1:
+		case square2: {
+			const std::uint8_t duty = reg(0xFF11 + id * 5) >> 6;
+			return ((detail::duty_patterns[duty] >> (7 - c.position)) & 1) ? c.volume : 0;
+		}
+		case wave: {
+			const std::uint8_t code = (reg(0xFF1C) >> 5) & 3;
+			if (code == 0) {
+				return 0;
+			}
+			const std::uint8_t byte = m_wave_ram[c.position / 2];
+			const std::uint8_t sample = (c.position & 1) ? (byte & 0x0F) : (byte >> 4);
+			return sample >> (code - 1);
+		}
+		case noise:
+			return (~c.position & 1) ? c.volume : 0;
+		}
+		return 0;
+	}
+
+	// Moves the amplitude of a channel in the delta buffers to its current output
+	constexpr void apu::update_output(channel_id id, std::uint64_t time) {
+		if (!m_synthesis) {
+			return;
+		}
+
+		auto& c = m_channels[id];
+
+		const std::int32_t value = digital_output(id);
+		const std::uint8_t nr50 = reg(0xFF24);
+		const std::uint8_t nr51 = reg(0xFF25);
+
+		const std::int32_t left = ((nr51 >> (id + 4)) & 1) ? value * (((nr50 >> 4) & 7) + 1) * volume_unit : 0;
+		const std::int32_t right = ((nr51 >> id) & 1) ? value * ((nr50 & 7) + 1) * volume_unit : 0;
+
+		if (left != c.amp_left) {
+			m_left.add_delta(time, left - c.amp_left);
+			c.amp_left = left;
+		}
+
+		if (right != c.amp_right) {
+			m_right.add_delta(time, right - c.amp_right);
+			c.amp_right = right;
+		}
+	}
+
+	constexpr void apu::update_all_outputs(std::uint64_t time) {
+		for (auto id : { square1, square2, wave, noise }) {
+			update_output(id, time);
+		}
+	}
+
+	constexpr std::uint16_t apu::sweep_calculate() {
+		const std::uint8_t nr10 = reg(0xFF10);
+		std::uint16_t frequency = m_sweep.shadow >> (nr10 & 7);
+
+		if (nr10 & 0x08) {
+			frequency = m_sweep.shadow - frequency;
+			m_sweep.negate_used = true;
+		}
+		else {
+			frequency = m_sweep.shadow + frequency;
+		}
+
+		if (frequency > 2047) {
+			m_channels[square1].enabled = false;
+		}
+
+		return frequency;
+	}
+
+	constexpr void apu::trigger(channel_id id) {
+		auto& c = m_channels[id];
+		c.enabled = c.dac;
+		c.next_step = period(id) == never ? never : m_time + period(id);
+
+		if (id != wave) {
+			const std::uint8_t envelope = reg(0xFF12 + id * 5);
+			c.volume = envelope >> 4;
+			c.env_up = envelope & 0x08;
+			c.env_period = envelope & 0x07;
+			c.env_timer = c.env_period;
+		}
+
+		if (id == wave) {
+			c.position = 0;
+		}
+		else if (id == noise) {
+			c.position = 0x7FFF;
+		}
+		else if (id == square1) {
+			const std::uint8_t nr10 = reg(0xFF10);
+			const std::uint8_t sweep_period = (nr10 >> 4) & 7;
+
+			m_sweep.shadow = c.frequency;
+			m_sweep.timer = sweep_period ? sweep_period : 8;
+			m_sweep.enabled = sweep_period || (nr10 & 7);
+			m_sweep.negate_used = false;
+
+			if (nr10 & 7) {
+				sweep_calculate();
+			}
+		}
+	}
+
+	// NRx4: length enable with its extra clock in the first half of a length
+	// period, and the trigger bit
+	constexpr void apu::write_length_control(channel_id id, std::uint8_t value) {
+		auto& c = m_channels[id];
+		const std::uint16_t max_length = id == wave ? 256 : 64;
+
+		const bool was_enabled = c.length_enable;
+		const bool next_step_skips_length = (m_fs_step & 1) != 0;
+		c.length_enable = value & 0x40;
+
+		if (!was_enabled && c.length_enable && next_step_skips_length && c.length > 0) {
+			if (--c.length == 0 && !(value & 0x80)) {
+				c.enabled = false;
+			}
+		}
+
+		if (value & 0x80) {
+			if (c.length == 0) {
+				c.length = max_length;
+				if (c.length_enable && next_step_skips_length) {
+					c.length--;
+				}
+			}
+			trigger(id);
+		}
+	}
+
+	constexpr void apu::power_off() {
+		std::fill(m_regs.begin(), m_regs.begin() + 0x16, 0);
+
+		// length counters survive on the DMG
+		for (auto& c : m_channels) {
+			const auto length = c.length;
+			c = channel_t{ .length = length, .amp_left = c.amp_left, .amp_right = c.amp_right };
+		}
+		m_sweep = {};
+		m_power = false;
+
+		update_all_outputs(m_time);
+	}
+
+	constexpr uint8_t apu::read_register(uint16_t addr) {
+		sync();
+
+		if (addr == 0xFF26) {
+			std::uint8_t status = m_power ? 0x80 : 0x00;
+			for (std::size_t i = 0; i < m_channels.size(); i++) {
+				status |= m_channels[i].enabled ? (1 << i) : 0;
+			}
+			return status | detail::apu_read_masks[addr - 0xFF10];
+		}
+
+		return reg(addr) | detail::apu_read_masks[addr - 0xFF10];
+	}
+
+	constexpr void apu::write_register(uint16_t addr, uint8_t value) {
+		sync();
+
+		if (m_deferred) {
+			m_deferred->record({ m_time, addr, value });
+		}
+
+		if (addr == 0xFF26) {
+			const bool power = value & 0x80;
+			if (m_power && !power) {
+				power_off();
+			}
+			else if (!m_power && power) {
+				m_power = true;
+				m_fs_step = 0;
+				m_fs_next = m_time + frame_sequencer_period;
+			}
+			return;
+		}
+
+		const std::size_t offset = addr - 0xFF10;
+		const bool length_register = offset < 0x14 && offset % 5 == 1;
+
+		// only the length counters can be written while the APU is off
+		if (!m_power && !length_register) {
+			return;
+		}
+
+		if (offset >= 0x14) {
+			reg(addr) = value;
+			if (addr == 0xFF24 || addr == 0xFF25) {
+				update_all_outputs(m_time);
+			}
+			return;
+		}
+
+		const auto id = static_cast<channel_id>(offset / 5);
+		auto& c = m_channels[id];
+
+		if (m_power) {
+			reg(addr) = value;
+		}
+
+		switch (offset % 5) {
+		case 0:
+			if (id == square1 && m_sweep.negate_used && !(value & 0x08)) {
+				c.enabled = false;
+			}
+			else if (id == wave) {
+				c.dac = value & 0x80;
+				if (!c.dac) {
+					c.enabled = false;
+				}
+			}
+			break;
+		case 1:
+			c.length = id == wave ? 256 - value : 64 - (value & 0x3F);
+			break;
+		case 2:
+			if (id != wave) {
+				c.dac = (value & 0xF8) != 0;
+				if (!c.dac) {
+					c.enabled = false;
+				}
+			}
+			break;
+		case 3:
+			if (id == noise) {
+				if (c.enabled && c.next_step == never) {
+					c.next_step = period(id) == never ? never : m_time + period(id);
+				}
+			}
+			else {
+				c.frequency = static_cast<std::uint16_t>((c.frequency & 0x700) | value);
+			}
+			break;
+		case 4:
+			if (id != noise) {
+				c.frequency = static_cast<std::uint16_t>((c.frequency & 0xFF) | ((value & 0x07) << 8));
+			}
+			write_length_control(id, value);
+			break;
+		}
+
+		update_output(id, m_time);
+	}
+
+	constexpr uint8_t apu::read_wave(uint16_t addr) {
+		sync();
+
+		// while the wave channel plays, the CPU sees the byte being played
+		const auto& c = m_channels[wave];
+		if (c.enabled) {
+			return m_wave_ram[c.position / 2];
+		}
+		return m_wave_ram[addr - 0xFF30];
+	}
+
+	constexpr void apu::write_wave(uint16_t addr, uint8_t value) {
+		sync();
+
+		if (m_deferred) {
+			m_deferred->record({ m_time, addr, value });
+		}
+
+		const auto& c = m_channels[wave];
+		if (c.enabled) {
+			m_wave_ram[c.position / 2] = value;
+		}
+		else {
+			m_wave_ram[addr - 0xFF30] = value;
+		}
+	}
+
+}
@@ -1,7 +1,199 @@
 #pragma once
 
+#include <algorithm>
 #include <fstream>
 #include <cstring>
 #include <utility>
 
-#include <yahbog/emulator.h>
\ No newline at end of file
+#include <yahbog/emulator.h>
+
+namespace yahbog {
+
+	constexpr emulator::memory_run emulator::memory_run_at(std::uint16_t addr) {
+		auto run = [addr](memory_region region, std::uint16_t base, std::uint16_t end) {
+			return memory_run{ region, static_cast<std::uint16_t>(addr - base), static_cast<std::uint16_t>(end - addr + 1) };
+		};
+
+		if (addr >= 0x8000 && addr <= 0x9FFF) return run(memory_region::vram, 0x8000, 0x9FFF);
+		if (addr >= 0xA000 && addr <= 0xBFFF) return run(memory_region::ext_ram, 0xA000, 0xBFFF);
+		if (addr >= 0xC000 && addr <= 0xDFFF) return run(memory_region::wram, 0xC000, 0xDFFF);
+		if (addr >= 0xE000 && addr <= 0xFDFF) return run(memory_region::wram, 0xE000, 0xFDFF);
+		if (addr >= 0xFE00 && addr <= 0xFE9F) return run(memory_region::oam, 0xFE00, 0xFE9F);
+		if (addr >= 0xFF80 && addr <= 0xFFFE) return run(memory_region::hram, 0xFF80, 0xFFFE);
+
+		if (!decltype(mmu)::handles(addr)) {
+			auto end = addr;
+			while (end < 0xFFFF && !decltype(mmu)::handles(end + 1)) {
+				end++;
+			}
+			return run(memory_region::open_bus, addr, end);
+		}
+
+		// ROM reads depend on the mapper and everything else is a register
+		return { memory_region::bus, 0, 1 };
+	}
+
+	constexpr std::span<const std::uint8_t> emulator::region_storage(memory_region region) {
+		switch (region) {
+		case memory_region::wram: return wram.wram;
+		case memory_region::hram: return hram.memory;
+		case memory_region::vram: return ppu.video_ram();
+		case memory_region::oam: return ppu.object_attributes();
+		case memory_region::ext_ram: return rom.mapped_ram();
+		default: return {};
+		}
+	}
+
+	constexpr void emulator::peek_span(std::uint16_t addr, std::span<std::uint8_t> out) {
+		if (addr + out.size() > 0x10000) {
+			throw std::out_of_range(std::format("Span {:04X}+{} leaves the address space", addr, out.size()));
+		}
+
+		std::size_t done = 0;
+		while (done < out.size()) {
+			const auto a = static_cast<std::uint16_t>(addr + done);
+			const auto run = memory_run_at(a);
+			const auto count = (std::min<std::size_t>)(run.length, out.size() - done);
+			const auto storage = region_storage(run.region);
+
+			if (run.region == memory_region::open_bus) {
+				std::ranges::fill(out.subspan(done, count), std::uint8_t{ 0xFF });
+				done += count;
+			}
+			else if (run.offset + count <= storage.size()) {
+				std::ranges::copy(storage.subspan(run.offset, count), out.begin() + done);
+				done += count;
+			}
+			else {
+				out[done++] = mmu.read(a);
+			}
+		}
+	}
+
+	constexpr void emulator::poke_span(std::uint16_t addr, std::span<const std::uint8_t> in) {
+		if (addr + in.size() > 0x10000) {
+			throw std::out_of_range(std::format("Span {:04X}+{} leaves the address space", addr, in.size()));
+		}
+
+		std::size_t done = 0;
+		while (done < in.size()) {
+			const auto a = static_cast<std::uint16_t>(addr + done);
+			const auto run = memory_run_at(a);
+			const auto count = (std::min<std::size_t>)(run.length, in.size() - done);
+
+			std::span<std::uint8_t> storage;
+			switch (run.region) {
+			case memory_region::wram: storage = wram.wram; break;
+			case memory_region::hram: storage = hram.memory; break;
+			case memory_region::ext_ram: storage = rom.mapped_ram(); break;
+			default: break;
+			}
+
+			if (run.region == memory_region::open_bus) {
+				done += count;
+			}
+			else if (run.offset + count <= storage.size()) {
+				std::ranges::copy(in.subspan(done, count), storage.begin() + run.offset);
+				done += count;
+			}
+			else {
+				mmu.write(a, in[done]);
+				done++;
+			}
+		}
+	}
+
+	inline std::size_t emulator::state_size() {
+		state_sizer sizer;
+		serialize(sizer);
+		return sizeof(state_header) + sizer.position();
+	}
+
+	inline std::size_t emulator::save_state(std::span<std::byte> out) {
+		state_writer writer(out);
+
+		state_header header{ .rom_hash = rom.hash() };
+		writer(header);
+		serialize(writer);
+
+		// the size is only known once everything is written
+		header.size = writer.position();
+		std::memcpy(out.data(), &header, sizeof(header));
+		return writer.position();
+	}
+
+	inline std::uint64_t emulator::state_hash() {
+		state_hasher hasher;
+		hasher(rom.hash());
+		serialize(hasher);
+		return hasher.digest();
+	}
+
+	inline std::unique_ptr<emulator> emulator::clone() const {
+		auto copy = std::make_unique<emulator>();
+
+		// the bus, the handler table and the pointers into it are the copy's own
+		copy->wram = wram;
+		copy->hram = hram;
+		copy->rom = rom;
+		copy->z80 = z80;
+		copy->ppu = ppu;
+		copy->spu = spu;
+		copy->pad = pad;
+
+		copy->z80.set_reader(copy->reader);
+		copy->z80.set_writer(copy->writer);
+		copy->ppu.set_bus(&copy->reader, &copy->writer);
+		copy->spu.set_clock(copy->z80.cycle_counter());
+
+		copy->ppu.clear_output();
+		copy->ppu.defer_rendering(nullptr);
+		if (copy->spu.synthesis_deferred()) {
+			copy->spu.defer_synthesis(nullptr);
+		}
+
+		return copy;
+	}
+
+	inline void emulator::load_state(std::span<const std::byte> in) {
+		if (ppu.rendering_deferred() || spu.synthesis_deferred()) {
+			throw std::logic_error("Cannot load a savestate while rendering or synthesis is deferred");
+		}
+
+		state_reader reader(in);
+
+		state_header header{};
+		reader(header);
+
+		if (header.magic != state_header::expected_magic) {
+			throw std::invalid_argument("Not a savestate");
+		}
+
+		if (header.version != state_header::current_version) {
+			throw std::invalid_argument(std::format("Savestate version {} is not supported (expected {})", header.version, state_header::current_version));
+		}
+
+		if (header.rom_hash != rom.hash()) {
+			throw std::invalid_argument(std::format("Savestate belongs to ROM {:016X}, but {:016X} is loaded", header.rom_hash, rom.hash()));
+		}
+
+		if (header.size < sizeof(state_header)) {
+			throw std::invalid_argument(std::format("Savestate header gives an impossible size of {} bytes", header.size));
+		}
+
+		if (header.size > in.size()) {
+			throw std::invalid_argument(std::format("Savestate is truncated: {} of {} bytes", in.size(), header.size));
+		}
+
+		// nothing is loaded until the whole body is known to fit the header's size,
+		// so a refused state leaves the emulator as it was
+		state_validator validator(in.subspan(sizeof(state_header), header.size - sizeof(state_header)));
+		serialize(validator);
+		if (sizeof(state_header) + validator.position() != header.size) {
+			throw std::invalid_argument(std::format("Savestate holds {} bytes, but its header says {}", sizeof(state_header) + validator.position(), header.size));
+		}
+
+		serialize(reader);
+	}
+
+}
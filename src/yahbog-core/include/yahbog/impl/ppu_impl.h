@@ -2,32 +2,67 @@
 
 #include <yahbog/ppu.h>
 #include <utility>
+#include <algorithm>
+#include <bit>
 
 namespace yahbog {
 
-	constexpr void gpu::tick(std::uint8_t cycles) {
+	constexpr void gpu::reset() {
+		lcdc.write(0x91);
+		lcd_status.write(0x00);
+		scy = 0;
+		scx = 0;
+		ly = 0;
+		lyc = 0;
+		bgp.write(0xFC);
+		obp0.write(0xFF);
+		obp1.write(0xFF);
+		wy = 0;
+		wx = 0;
+
+		mode = mode_t::oam;
+		mode_clock = 0;
+		window_line = 0;
+		stat_line = false;
+		update_stat();
+	}
+
+	constexpr std::uint8_t gpu::tick(std::uint8_t cycles) {
+		if (!lcdc.v.lcd_display) {
+			return 0;
+		}
+
+		std::uint8_t requested = 0;
+
 		mode_clock += cycles;
 		switch (mode) {
 		case mode_t::oam:
 			if (mode_clock >= 80) {
-				mode_clock = 0;
+				mode_clock -= 80;
 				mode = mode_t::vram;
 			}
 			break;
 		case mode_t::vram:
 			if (mode_clock >= 172) {
-				mode_clock = 0;
+				mode_clock -= 172;
 				mode = mode_t::hblank;
 
-				render_scanline();
+				end_scanline();
 			}
 			break;
 		case mode_t::hblank:
 			if (mode_clock >= 204) {
-				mode_clock = 0;
+				mode_clock -= 204;
 				ly++;
 				if (ly == 144) {
 					mode = mode_t::vblank;
+					m_frames++;
+					m_frame_ready = true;
+					requested |= interrupt::vblank;
+
+					if (m_deferred) {
+						submit_log(true);
+					}
 				}
 				else {
 					mode = mode_t::oam;
@@ -36,10 +71,11 @@ namespace yahbog {
 			break;
 		case mode_t::vblank:
 			if (mode_clock >= 456) {
-				mode_clock = 0;
+				mode_clock -= 456;
 				ly++;
 				if (ly > 153) {
 					ly = 0;
+					window_line = 0;
 					mode = mode_t::oam;
 				}
 			}
@@ -47,9 +83,369 @@ namespace yahbog {
 		default: std::unreachable();
 		}
 
+		return requested | update_stat();
+	}
+
+	// Refreshes the mode and coincidence bits of STAT and returns the
+	// STAT interrupt if any enabled source became active
+	constexpr std::uint8_t gpu::update_stat() {
+		lcd_status.v.mode = static_cast<std::uint8_t>(mode);
+		lcd_status.v.coincidence = ly == lyc;
+
+		const bool line =
+			(lcd_status.v.mode0 && mode == mode_t::hblank) ||
+			(lcd_status.v.mode1 && mode == mode_t::vblank) ||
+			(lcd_status.v.mode2 && mode == mode_t::oam) ||
+			(lcd_status.v.lyc_condition && lcd_status.v.coincidence);
+
+		const bool rising = line && !stat_line;
+		stat_line = line;
+
+		return rising ? interrupt::lcd_stat : 0;
+	}
+
+	constexpr std::uint32_t gpu::frame_dot() const {
+		std::size_t dot = mode_clock;
+		if (mode == mode_t::vram) {
+			dot += 80;
+		}
+		else if (mode == mode_t::hblank) {
+			dot += 80 + 172;
+		}
+		return static_cast<std::uint32_t>(ly * dots_per_line + dot);
+	}
+
+	constexpr void gpu::record(uint16_t addr, uint8_t value, std::uint8_t line) {
+		if (!m_deferred) {
+			return;
+		}
+
+		m_log.push_back({ frame_dot(), addr, value, line });
+		if (m_log.size() >= max_log_entries) {
+			submit_log(false);
+		}
+	}
+
+	constexpr void gpu::submit_log(bool frame_complete) {
+		m_deferred->submit(m_log, frame_complete);
+		m_log.clear();
+	}
+
+	constexpr void gpu::replay(const ppu_log_entry& entry) {
+		if (entry.addr == scanline_marker) {
+			ly = entry.line;
+			window_line = entry.value;
+			render_scanline();
+			return;
+		}
+
+		if (entry.addr >= 0x8000 && entry.addr <= 0x9FFF) {
+			write_vram(entry.addr, entry.value);
+			return;
+		}
+
+		if (entry.addr >= 0xFE00 && entry.addr <= 0xFE9F) {
+			write_oam(entry.addr, entry.value);
+			return;
+		}
+
+		switch (entry.addr) {
+		case 0xFF40: write_lcdc(entry.addr, entry.value); break;
+		case 0xFF42: scy = entry.value; break;
+		case 0xFF43: scx = entry.value; break;
+		case 0xFF47: bgp.write(entry.value); break;
+		case 0xFF48: obp0.write(entry.value); break;
+		case 0xFF49: obp1.write(entry.value); break;
+		case 0xFF4A: wy = entry.value; break;
+		case 0xFF4B: wx = entry.value; break;
+		default: break;
+		}
+	}
+
+	constexpr bool gpu::window_visible() const {
+		return lcdc.v.bg_display && lcdc.v.window_display && ly >= wy && wx <= 166;
+	}
+
+	// Called at the end of mode 3: draws the line, or logs where it would have been drawn
+	constexpr void gpu::end_scanline() {
+		if (m_deferred) {
+			record(scanline_marker, window_line, ly);
+		}
+		else {
+			render_scanline();
+		}
+
+		if (window_visible()) {
+			window_line++;
+		}
+	}
+
+	constexpr void gpu::write_lcdc(uint16_t addr, uint8_t value) {
+		record(addr, value);
+
+		const bool was_on = lcdc.v.lcd_display;
+		const auto old_obj_size = lcdc.v.obj_size;
+		lcdc.write(value);
+
+		if (lcdc.v.obj_size != old_obj_size) {
+			oam_dirty = true;
+		}
+
+		if (was_on && !lcdc.v.lcd_display) {
+			// turning the LCD off resets LY and parks the PPU in HBlank
+			ly = 0;
+			mode_clock = 0;
+			window_line = 0;
+			mode = mode_t::hblank;
+			lcd_status.v.mode = 0;
+			stat_line = false;
+		}
+		else if (!was_on && lcdc.v.lcd_display) {
+			mode_clock = 0;
+			mode = mode_t::oam;
+		}
+	}
+
+	constexpr void gpu::write_stat([[maybe_unused]] uint16_t addr, uint8_t value) {
+		// the mode and coincidence bits are read-only
+		const auto current_mode = lcd_status.v.mode;
+		const auto coincidence = lcd_status.v.coincidence;
+
+		lcd_status.write(value);
+		lcd_status.v.mode = current_mode;
+		lcd_status.v.coincidence = coincidence;
+	}
+
+	constexpr void gpu::write_dma([[maybe_unused]] uint16_t addr, uint8_t value) {
+		dma = value;
+
+		// the transfer is performed at once instead of over 160 machine cycles
+		const std::uint16_t source = static_cast<std::uint16_t>(value) << 8;
+		for (std::uint16_t i = 0; i < oam.size(); i++) {
+			write_oam(0xFE00 + i, (*read_fn)(source + i));
+		}
+		oam_dirty = true;
+	}
+
+	constexpr void gpu::build_sprite_index() {
+		sprite_lines.fill(0);
+
+		const int height = lcdc.v.obj_size ? 16 : 8;
+		for (std::size_t i = 0; i < oam_entries; i++) {
+			const int top = static_cast<int>(oam[i * 4]) - 16;
+			const int first = (std::max)(top, 0);
+			const int last = (std::min)(top + height, static_cast<int>(screen_height));
+
+			for (int y = first; y < last; y++) {
+				sprite_lines[y] |= std::uint64_t{ 1 } << i;
+			}
+		}
+
+		oam_dirty = false;
+	}
+
+	constexpr void gpu::render_sprites(std::span<const std::uint8_t, 160> bg, std::span<std::uint8_t, 160> shades) {
+		if (oam_dirty) {
+			build_sprite_index();
+		}
+
+		// the DMG picks the first ten entries in OAM order that overlap the line
+		std::array<std::uint8_t, sprites_per_line> selected{};
+		std::size_t count = 0;
+		for (auto mask = sprite_lines[ly]; mask && count < sprites_per_line; mask &= mask - 1) {
+			selected[count++] = static_cast<std::uint8_t>(std::countr_zero(mask));
+		}
+
+		if (count == 0) {
+			return;
+		}
+
+		// lower X wins, ties go to the lower OAM index; the stable sort keeps OAM order for ties
+		std::stable_sort(selected.begin(), selected.begin() + count, [this](std::uint8_t a, std::uint8_t b) {
+			return oam[a * 4 + 1] < oam[b * 4 + 1];
+		});
+
+		const std::uint8_t height = lcdc.v.obj_size ? 16 : 8;
+		std::array<bool, screen_width> claimed{};
+
+		for (std::size_t s = 0; s < count; s++) {
+			const std::size_t base = selected[s] * 4;
+			const std::uint8_t sprite_y = oam[base];
+			const std::uint8_t sprite_x = oam[base + 1];
+			const std::uint8_t attributes = oam[base + 3];
+
+			const bool behind_bg = attributes & 0x80;
+			const bool flip_y = attributes & 0x40;
+			const bool flip_x = attributes & 0x20;
+			const std::uint8_t palette = (attributes & 0x10) ? obp1.read() : obp0.read();
+
+			std::uint8_t tile = oam[base + 2];
+			if (height == 16) {
+				tile &= 0xFE;
+			}
+
+			std::uint8_t row = static_cast<std::uint8_t>(ly + 16 - sprite_y);
+			if (flip_y) {
+				row = height - 1 - row;
+			}
+
+			const std::size_t tile_addr = tile * 16 + row * 2;
+			const std::uint8_t lo = vram[tile_addr];
+			const std::uint8_t hi = vram[tile_addr + 1];
+
+			for (int px = 0; px < 8; px++) {
+				const int x = static_cast<int>(sprite_x) - 8 + px;
+				if (x < 0 || x >= static_cast<int>(screen_width) || claimed[x]) {
+					continue;
+				}
+
+				const auto bit = flip_x ? px : 7 - px;
+				const std::uint8_t color = ((lo >> bit) & 1) | (((hi >> bit) & 1) << 1);
+				if (color == 0) {
+					continue;
+				}
+
+				// the highest priority opaque sprite pixel owns the dot, even when the BG hides it
+				claimed[x] = true;
+				if (!behind_bg || bg[x] == 0) {
+					shades[x] = (palette >> (color * 2)) & 0b11;
+				}
+			}
+		}
 	}
 
 	constexpr void gpu::render_scanline()
 	{
+		// colour indices before the palette is applied
+		std::array<std::uint8_t, screen_width> line{};
+
+		// LCDC.0 blanks both the background and the window on the DMG
+		if (lcdc.v.bg_display) {
+			const auto fetch_tile_row = [this](std::uint16_t map_base, std::uint8_t tx, std::uint8_t ty, std::uint8_t row) {
+				const std::uint8_t tile = vram[map_base + ty * 32 + tx];
+				const std::size_t tile_addr = lcdc.v.bg_tile_data
+					? tile * 16
+					: 0x1000 + static_cast<std::int8_t>(tile) * 16;
+
+				return std::pair{ vram[tile_addr + row * 2], vram[tile_addr + row * 2 + 1] };
+			};
+
+			const std::uint16_t bg_map = lcdc.v.bg_tile_map ? 0x1C00 : 0x1800;
+			const std::uint8_t bg_y = ly + scy;
+
+			for (std::size_t x = 0; x < screen_width; x++) {
+				const std::uint8_t bg_x = static_cast<std::uint8_t>(x + scx);
+				const auto [lo, hi] = fetch_tile_row(bg_map, bg_x / 8, bg_y / 8, bg_y % 8);
+				const auto bit = 7 - (bg_x % 8);
+				line[x] = ((lo >> bit) & 1) | (((hi >> bit) & 1) << 1);
+			}
+
+			if (window_visible()) {
+				const std::uint16_t win_map = lcdc.v.window_tile_map ? 0x1C00 : 0x1800;
+				const std::size_t start = wx < 7 ? 0 : wx - 7;
+
+				for (std::size_t x = start; x < screen_width; x++) {
+					const std::uint8_t win_x = static_cast<std::uint8_t>(x + 7 - wx);
+					const auto [lo, hi] = fetch_tile_row(win_map, win_x / 8, window_line / 8, window_line % 8);
+					const auto bit = 7 - (win_x % 8);
+					line[x] = ((lo >> bit) & 1) | (((hi >> bit) & 1) << 1);
+				}
+			}
+		}
+
+		const std::uint8_t palette = lcdc.v.bg_display ? bgp.read() : 0x00;
+		std::array<std::uint8_t, screen_width> shades{};
+		for (std::size_t x = 0; x < screen_width; x++) {
+			shades[x] = (palette >> (line[x] * 2)) & 0b11;
+		}
+
+		if (lcdc.v.obj_display) {
+			render_sprites(line, shades);
+		}
+
+		write_line(shades);
+	}
+
+	namespace detail {
+		constexpr void pack_2bpp(std::span<const std::uint8_t, 160> shades, std::span<std::uint8_t> out) {
+			for (std::size_t i = 0; i < shades.size() / 4; i++) {
+				out[i] = static_cast<std::uint8_t>(
+					(shades[i * 4] << 6) | (shades[i * 4 + 1] << 4) | (shades[i * 4 + 2] << 2) | shades[i * 4 + 3]);
+			}
+		}
+	}
+
+	constexpr void gpu::set_output(const frame_output& output) {
+		const auto line_bytes = bytes_per_pixel_line(output.format, screen_width);
+		const auto stride = output.stride ? output.stride : line_bytes;
+		const auto required = stride * (screen_height - 1) + line_bytes;
+
+		if (stride < line_bytes || output.buffers[0].size() < required ||
+			(!output.buffers[1].empty() && output.buffers[1].size() < required)) {
+			throw std::invalid_argument(std::format("Frame output needs {} bytes per buffer", required));
+		}
+
+		m_output = output;
+		m_line_bytes = line_bytes;
+		m_stride = stride;
+		m_back = 0;
+		m_has_output = true;
+	}
+
+	constexpr void gpu::write_line(std::span<const std::uint8_t, 160> shades) {
+		if (m_hashing) {
+			std::array<std::uint8_t, screen_width / 4> packed{};
+			detail::pack_2bpp(shades, packed);
+
+			if (ly == 0) {
+				m_line_hasher.reset();
+			}
+			m_line_hasher.update(packed);
+			if (ly == screen_height - 1) {
+				m_frame_hash = m_line_hasher.digest();
+			}
+		}
+
+		if (!m_has_output) {
+			detail::pack_2bpp(shades, std::span{ m_framebuffer }.subspan(ly * screen_width / 4, screen_width / 4));
+			return;
+		}
+
+		auto out = m_output.buffers[m_back].subspan(ly * m_stride, m_line_bytes);
+		const auto& palette = m_output.palette;
+
+		switch (m_output.format) {
+		case pixel_format::packed_2bpp:
+			detail::pack_2bpp(shades, out);
+			break;
+		case pixel_format::indexed8:
+			for (std::size_t x = 0; x < screen_width; x++) {
+				out[x] = palette.indices[shades[x]];
+			}
+			break;
+		case pixel_format::rgba8888:
+			for (std::size_t x = 0; x < screen_width; x++) {
+				const auto& c = palette.colors[shades[x]];
+				out[x * 4 + 0] = c.r;
+				out[x * 4 + 1] = c.g;
+				out[x * 4 + 2] = c.b;
+				out[x * 4 + 3] = c.a;
+			}
+			break;
+		case pixel_format::bgra8888:
+			for (std::size_t x = 0; x < screen_width; x++) {
+				const auto& c = palette.colors[shades[x]];
+				out[x * 4 + 0] = c.b;
+				out[x * 4 + 1] = c.g;
+				out[x * 4 + 2] = c.r;
+				out[x * 4 + 3] = c.a;
+			}
+			break;
+		}
+
+		// the finished frame becomes the front buffer
+		if (ly == screen_height - 1 && !m_output.buffers[1].empty()) {
+			m_back ^= 1;
+		}
 	}
-}
\ No newline at end of file
+}
@@ -4,7 +4,7 @@
 
 namespace yahbog {
 
-	constexpr rom_header_t rom_header_t::from_bytes(std::span<std::uint8_t> data) {
+	constexpr rom_header_t rom_header_t::from_bytes(std::span<const std::uint8_t> data) {
 		rom_header_t header;
 		
 		#define COPY_FIELD(field) header.field = data[offsetof(rom_header_t, field)]
@@ -45,23 +45,4 @@ namespace yahbog {
 		}
 	}
 
-	constexpr bool rom_t::load_rom(std::vector<std::uint8_t>&& data) {
-		if(data.size() < 0x8000) {
-			return false;
-		}
-		
-		rom_data = std::move(data);
-		header_ = rom_header_t::from_bytes({rom_data.data() + 0x0100, sizeof(rom_header_t)});
-
-		auto ram_size = detail::calc_ram_size(header_.ram_size);
-		if(ram_size > 0) {
-			ext_ram.resize(ram_size);
-		}
-
-		rom_bank = 1;
-		ram_bank = (std::numeric_limits<std::size_t>::max)();
-
-		return true;
-	}
-
 }
\ No newline at end of file
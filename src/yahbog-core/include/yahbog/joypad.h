@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <yahbog/mmu.h>
+#include <yahbog/registers.h>
+
+namespace yahbog {
+
+	// bits of the host-side button state, set while pressed
+	namespace button {
+		constexpr std::uint8_t right  = 1 << 0;
+		constexpr std::uint8_t left   = 1 << 1;
+		constexpr std::uint8_t up     = 1 << 2;
+		constexpr std::uint8_t down   = 1 << 3;
+		constexpr std::uint8_t a      = 1 << 4;
+		constexpr std::uint8_t b      = 1 << 5;
+		constexpr std::uint8_t select = 1 << 6;
+		constexpr std::uint8_t start  = 1 << 7;
+	}
+
+	// P1 at 0xFF00: the CPU selects the direction and/or action group with bits
+	// 4 and 5 and reads the selected buttons, active low, in bits 0-3
+	class joypad {
+	public:
+		consteval static auto address_range() {
+			return std::array{
+				address_range_t<joypad>{ 0xFF00, 0xFF00, &joypad::read_p1, &joypad::write_p1 }
+			};
+		}
+
+		// Post-boot: both groups selected, nothing pressed
+		constexpr void reset() noexcept {
+			m_select = 0;
+			m_pressed = 0;
+		}
+
+		// Replaces the pressed buttons and returns the interrupts it requested as an
+		// IF mask: the joypad interrupt fires when a selected line goes low
+		constexpr std::uint8_t set_buttons(std::uint8_t pressed) noexcept {
+			const auto before = lines();
+			m_pressed = pressed;
+			return (before & ~lines() & 0x0F) ? interrupt::joypad : 0;
+		}
+
+		constexpr std::uint8_t buttons() const noexcept { return m_pressed; }
+
+		constexpr std::uint8_t read_p1([[maybe_unused]] std::uint16_t addr) {
+			return 0xC0 | m_select | lines();
+		}
+
+		constexpr void write_p1([[maybe_unused]] std::uint16_t addr, std::uint8_t value) {
+			m_select = value & 0x30;
+		}
+
+		template<typename IO>
+		void serialize(IO& io) {
+			io(m_select);
+			io(m_pressed);
+		}
+
+	private:
+		constexpr std::uint8_t lines() const noexcept {
+			std::uint8_t low = 0;
+			if (!(m_select & 0x10)) {
+				low |= m_pressed & 0x0F;
+			}
+			if (!(m_select & 0x20)) {
+				low |= m_pressed >> 4;
+			}
+			return ~low & 0x0F;
+		}
+
+		std::uint8_t m_select = 0;
+		std::uint8_t m_pressed = 0;
+	};
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <yahbog/emulator.h>
+
+namespace yahbog {
+
+	// Experimental. Runs many lanes that start from the same state, executing
+	// each distinct state once: lanes whose whole machine state is identical
+	// share one emulator. A group splits when its lanes are given different
+	// buttons, and groups merge again once their states are byte-for-byte equal,
+	// so lanes that stay in lockstep cost a single instance between them.
+	class lockstep_runner {
+	public:
+		// Starts every lane as a copy of prototype
+		lockstep_runner(const emulator& prototype, std::size_t lanes);
+
+		std::size_t lanes() const noexcept { return m_group_of.size(); }
+
+		// Distinct instances currently being run
+		std::size_t groups() const noexcept { return m_groups.size(); }
+
+		// A read-only view of the instance a lane is currently run on. It is
+		// shared with the other lanes in its group, so it is only valid until the
+		// next step, which may split or merge groups
+		const emulator& lane(std::size_t i) const { return *m_groups[m_group_of[i]].emu; }
+
+		// Pressed buttons per lane, applied at the start of every step
+		std::span<std::uint8_t> buttons() noexcept { return m_buttons; }
+
+		// Runs one frame on every lane
+		void run_frame();
+
+		// Runs the given number of machine cycles on every lane
+		void run_cycles(std::size_t cycles);
+
+	private:
+		struct group {
+			std::unique_ptr<emulator> emu;
+			std::vector<std::size_t> lanes;
+		};
+
+		template<typename Step>
+		void step(Step run);
+
+		// Splits groups whose lanes were given different buttons
+		void split();
+
+		// Merges groups that reached the same state
+		void merge();
+
+		void reindex();
+
+		std::vector<group> m_groups;
+		std::vector<std::size_t> m_group_of;
+		std::vector<std::uint8_t> m_buttons;
+
+		// savestates of merge candidates, reused between steps
+		std::vector<std::vector<std::byte>> m_states;
+	};
+
+}
@@ -58,6 +58,11 @@ namespace yahbog {
 		constexpr void write(uint16_t addr, uint8_t data) {
 			memory[addr - AddressStart] = data;
 		}
+
+		template<typename IO>
+		void serialize(IO& io) {
+			io(memory);
+		}
 	};
 
 	namespace detail {
@@ -138,6 +143,11 @@ namespace yahbog {
 			std::get<idx>(m_handlers) = handler;
 		}
 
+		// Whether any handler claims addr; read and write throw for those that none does
+		constexpr static bool handles(uint16_t addr) {
+			return jump_table[addr].read != nullptr;
+		}
+
 		constexpr uint8_t read(uint16_t addr) {
 			auto handler = jump_table[addr].read;
 			if (handler) {
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#include <yahbog/emulator.h>
+
+namespace yahbog {
+
+	// A recorded run: the state it starts from, then every joypad change and
+	// frame end, timed by the CPU's cycle counter, so replay is bit-exact. Each
+	// event is a varint of the cycles since the previous event shifted left by
+	// one, with the low bit set for a frame end; input events are followed by
+	// the pressed buttons. A savestate every keyframe interval, and one at the
+	// end, lets a player seek without replaying from the start and lets the
+	// replay be verified segment by segment.
+	struct movie {
+		struct keyframe {
+			std::uint64_t frame;
+			std::uint64_t cycle;
+			// where replay continues from this keyframe
+			std::uint64_t event_offset;
+			std::uint64_t state_offset;
+			std::uint64_t state_size;
+		};
+
+		std::uint64_t rom_hash = 0;
+		std::uint64_t frames = 0;
+
+		// in frame order; the first holds the starting state
+		std::vector<keyframe> index;
+		std::vector<std::byte> events;
+		std::vector<std::byte> states;
+
+		// Throws std::runtime_error if the file cannot be written
+		void save(const std::filesystem::path& path) const;
+
+		// Throws std::runtime_error if the file cannot be read, and
+		// std::invalid_argument if it is not a well-formed movie
+		static movie load(const std::filesystem::path& path);
+	};
+
+	// Records a movie from an emulator's current state. Input must go through
+	// the recorder, and frames must be run by it, for the movie to replay.
+	class movie_recorder {
+	public:
+		// Throws std::invalid_argument if keyframe_interval is zero
+		explicit movie_recorder(emulator& emu, std::size_t keyframe_interval = 600);
+
+		// Presses buttons (a mask of button::*) from the current cycle on
+		void set_buttons(std::uint8_t pressed);
+
+		// Runs one frame and returns the machine cycles it took
+		std::size_t run_frame();
+
+		const movie& recording() const noexcept { return m_movie; }
+
+		// Saves a final keyframe and hands over the movie; the recorder is empty
+		// afterwards
+		movie finish();
+
+	private:
+		void add_keyframe();
+
+		emulator& m_emu;
+		movie m_movie;
+		std::size_t m_keyframe_interval;
+		std::uint64_t m_last_cycle;
+	};
+
+	// A segment whose replay did not end in the state of the keyframe after it
+	struct movie_divergence {
+		// index of the keyframe the segment starts from
+		std::size_t segment;
+		std::uint64_t first_frame;
+		std::uint64_t last_frame;
+		// emulator::state_hash of the keyframe and of the replay
+		std::uint64_t expected_hash;
+		std::uint64_t actual_hash;
+	};
+
+	// Replays the segments between consecutive keyframes in parallel, each from
+	// its keyframe on a clone of prototype, which must have the movie's ROM
+	// loaded. Only the emulated state is compared, so undrained audio and the
+	// like do not count. Returns the divergent segments in order, empty if the
+	// whole movie replays exactly. threads = 0 uses one per hardware thread.
+	std::vector<movie_divergence> verify_movie(const movie& m, const emulator& prototype, std::size_t threads = 0);
+
+	// Replays a movie into an emulator with the same ROM loaded. The movie must
+	// outlive the player.
+	class movie_player {
+	public:
+		// Loads the starting state. Throws std::invalid_argument if the movie was
+		// recorded with another ROM.
+		movie_player(const movie& m, emulator& emu);
+
+		// Replays up to the end of the next frame; false once the movie is over
+		bool run_frame();
+
+		// Moves to the end of the given frame, 0 being the start, from the nearest
+		// keyframe before it. Throws std::out_of_range past the last frame.
+		void seek(std::uint64_t frame);
+
+		// Restores the state saved at m.index[index], even if replay is already
+		// there. Throws std::out_of_range if there is no such keyframe.
+		void load_keyframe(std::size_t index);
+
+		std::uint64_t frame() const noexcept { return m_frame; }
+		bool finished() const noexcept { return m_pos == m_movie.events.size(); }
+
+	private:
+		void restore(const movie::keyframe& key);
+
+		const movie& m_movie;
+		emulator& m_emu;
+
+		std::uint64_t m_frame = 0;
+		std::uint64_t m_cycle = 0;
+		std::size_t m_pos = 0;
+	};
+
+}
@@ -3,41 +3,183 @@
 #include <yahbog/mmu.h>
 #include <yahbog/registers.h>
 #include <yahbog/operations.h>
+#include <yahbog/frame_output.h>
+#include <yahbog/utility/xxhash.h>
+
+#include <vector>
 
 namespace yahbog {
+
+	// A write that affects rasterization, or the point at which a scanline is drawn
+	struct ppu_log_entry {
+		// position in the frame, ly * 456 + dot within the line
+		std::uint32_t dot;
+		// bus address of the write, or gpu::scanline_marker
+		std::uint16_t addr;
+		// written value, or the window line counter for markers
+		std::uint8_t value;
+		// line being drawn for markers
+		std::uint8_t line;
+	};
+
+	// Receives the write log when the PPU defers rasterization (see ppu_worker)
+	class deferred_renderer {
+	public:
+		virtual ~deferred_renderer() = default;
+
+		// Takes ownership of the entries in log and leaves it empty. frame_complete
+		// is false when the log is flushed early because it grew too large.
+		virtual void submit(std::vector<ppu_log_entry>& log, bool frame_complete) = 0;
+	};
+
 	class gpu {
 	public:
 
 		constexpr gpu(read_fn_t* read_fn, write_fn_t* write_fn) : read_fn(read_fn), write_fn(write_fn) {}
 
-		constexpr void tick(std::uint8_t cycles);
+		// Rebinds the bus used for OAM DMA, e.g. after copying a gpu into another emulator
+		constexpr void set_bus(read_fn_t* read_fn, write_fn_t* write_fn) noexcept {
+			this->read_fn = read_fn;
+			this->write_fn = write_fn;
+		}
+
+		// Restores the post-boot register state of a DMG
+		constexpr void reset();
+
+		// Advances the PPU by the given number of dots (T-cycles) and returns
+		// the interrupts it requested as an IF mask
+		constexpr std::uint8_t tick(std::uint8_t cycles);
+
+		// Packed 2bpp frame, only drawn while no frame_output is registered
 		constexpr const auto& framebuffer() const { return m_framebuffer; }
-		constexpr bool framebuffer_ready() const { return mode == mode_t::vblank; }
+
+		// Set when a frame completes, until the frame is acknowledged
+		constexpr bool framebuffer_ready() const { return m_frame_ready; }
+		constexpr void acknowledge_frame() { m_frame_ready = false; }
+
+		// Draws lines straight into caller-owned buffers instead of framebuffer().
+		// Throws std::invalid_argument if a buffer cannot hold a frame. Register
+		// the output before attaching a ppu_worker.
+		constexpr void set_output(const frame_output& output);
+		constexpr void clear_output() { m_has_output = false; }
+		constexpr bool has_output() const { return m_has_output; }
+		constexpr const frame_output& output() const { return m_output; }
+
+		// XXH64 of the last completed frame's packed 2bpp shades, independent of the
+		// output format, equal to xxhash64_of(framebuffer()). Accumulated as lines
+		// are drawn, so it costs no extra pass over the frame.
+		constexpr std::uint64_t frame_hash() const { return m_frame_hash; }
+		constexpr void set_frame_hashing(bool enabled) { m_hashing = enabled; }
+		constexpr bool frame_hashing() const { return m_hashing; }
+
+		// The last completed frame of the registered output
+		constexpr std::span<const std::uint8_t> front_buffer() const {
+			return m_output.buffers[1].empty() ? m_output.buffers[0] : m_output.buffers[m_back ^ 1];
+		}
+
+		// Number of frames completed (VBlank entries) since construction
+		constexpr std::size_t frames() const { return m_frames; }
+
+		// Read-only views of VRAM (0x8000-0x9FFF) and OAM (0xFE00-0xFE9F); writes
+		// must go through the bus so deferred renderers see them
+		constexpr std::span<const std::uint8_t, 0x2000> video_ram() const { return vram; }
+		constexpr std::span<const std::uint8_t, 0xA0> object_attributes() const { return oam; }
+
+		constexpr static std::size_t screen_width = 160;
+		constexpr static std::size_t screen_height = 144;
+		constexpr static std::size_t dots_per_line = 456;
+		constexpr static std::size_t dots_per_frame = 70224;
+
+		// the framebuffer packs four 2bpp shades per byte, leftmost pixel in the high bits
+		constexpr static std::size_t bpp = 2;
+		constexpr static auto framebuffer_size = screen_width * screen_height / (8 / bpp);
+		using framebuffer_t = std::array<std::uint8_t, framebuffer_size>;
+
+		constexpr static std::uint16_t scanline_marker = 0x0000;
+
+		// While a renderer is attached, writes are logged and scanlines are drawn by
+		// the renderer instead; the gpu only keeps the state visible to the CPU
+		constexpr void defer_rendering(deferred_renderer* renderer) {
+			m_deferred = renderer;
+			m_log.clear();
+		}
+		constexpr bool rendering_deferred() const { return m_deferred != nullptr; }
+
+		// Applies a logged entry, drawing the scanline for markers
+		constexpr void replay(const ppu_log_entry& entry);
+
+		// Timing, registers, VRAM, OAM and the last frame; the registered output
+		// and deferred rendering are host configuration and stay as they are
+		template<typename IO>
+		void serialize(IO& io) {
+			io(mode_clock);
+			io(mode);
+			io(m_frames);
+			io(window_line);
+			io(stat_line);
+			// what the host has been shown of the frames so far
+			if constexpr (!IO::emulated_only) {
+				io(m_framebuffer);
+				io(m_frame_ready);
+				io(m_line_hasher);
+				io(m_frame_hash);
+			}
+			io(vram);
+			io(oam);
+			// an index rebuilt from OAM only when lines are drawn here
+			if constexpr (!IO::emulated_only) {
+				io(sprite_lines);
+				io(oam_dirty);
+			}
+			io(lcdc);
+			io(lcd_status);
+			io(scy);
+			io(scx);
+			io(ly);
+			io(lyc);
+			io(dma);
+			io(bgp);
+			io(obp0);
+			io(obp1);
+			io(wy);
+			io(wx);
+		}
 
 		consteval static auto address_range() {
 			return std::array{
 				address_range_t<gpu>{ 0x8000, 0x9FFF, &gpu::read_vram, &gpu::write_vram },
 				address_range_t<gpu>{ 0xFE00, 0xFE9F, &gpu::read_oam, &gpu::write_oam },
-				address_range_t<gpu>{ 0xFF40, 0xFF40, &gpu::read_register<&gpu::lcdc>, &gpu::write_register<&gpu::lcdc> },
-				address_range_t<gpu>{ 0xFF41, 0xFF41, &gpu::read_register<&gpu::lcd_status>, &gpu::write_register<&gpu::lcd_status> },
-				address_range_t<gpu>{ 0xFF42, 0xFF42, &gpu::read_member<&gpu::scy>, &gpu::write_member<&gpu::scy> },
-				address_range_t<gpu>{ 0xFF43, 0xFF43, &gpu::read_member<&gpu::scx>, &gpu::write_member<&gpu::scx> },
-				address_range_t<gpu>{ 0xFF44, 0xFF44, &gpu::read_member<&gpu::ly>, &gpu::write_member<&gpu::ly> },
+				address_range_t<gpu>{ 0xFF40, 0xFF40, &gpu::read_register<&gpu::lcdc>, &gpu::write_lcdc },
+				address_range_t<gpu>{ 0xFF41, 0xFF41, &gpu::read_register<&gpu::lcd_status>, &gpu::write_stat },
+				address_range_t<gpu>{ 0xFF42, 0xFF42, &gpu::read_member<&gpu::scy>, &gpu::write_logged_member<&gpu::scy> },
+				address_range_t<gpu>{ 0xFF43, 0xFF43, &gpu::read_member<&gpu::scx>, &gpu::write_logged_member<&gpu::scx> },
+				address_range_t<gpu>{ 0xFF44, 0xFF44, &gpu::read_member<&gpu::ly>, &gpu::write_readonly },
 				address_range_t<gpu>{ 0xFF45, 0xFF45, &gpu::read_member<&gpu::lyc>, &gpu::write_member<&gpu::lyc> },
-				address_range_t<gpu>{ 0xFF46, 0xFF46, &gpu::read_member<&gpu::dma>, &gpu::write_member<&gpu::dma> },
-				address_range_t<gpu>{ 0xFF47, 0xFF47, &gpu::read_register<&gpu::bgp>, &gpu::write_register<&gpu::bgp> },
-				address_range_t<gpu>{ 0xFF48, 0xFF48, &gpu::read_register<&gpu::obp0>, &gpu::write_register<&gpu::obp0> },
-				address_range_t<gpu>{ 0xFF49, 0xFF49, &gpu::read_register<&gpu::obp1>, &gpu::write_register<&gpu::obp1> },
-				address_range_t<gpu>{ 0xFF4A, 0xFF4A, &gpu::read_member<&gpu::wy>, &gpu::write_member<&gpu::wy> },
-				address_range_t<gpu>{ 0xFF4B, 0xFF4B, &gpu::read_member<&gpu::wx>, &gpu::write_member<&gpu::wx> }
+				address_range_t<gpu>{ 0xFF46, 0xFF46, &gpu::read_member<&gpu::dma>, &gpu::write_dma },
+				address_range_t<gpu>{ 0xFF47, 0xFF47, &gpu::read_register<&gpu::bgp>, &gpu::write_logged_register<&gpu::bgp> },
+				address_range_t<gpu>{ 0xFF48, 0xFF48, &gpu::read_register<&gpu::obp0>, &gpu::write_logged_register<&gpu::obp0> },
+				address_range_t<gpu>{ 0xFF49, 0xFF49, &gpu::read_register<&gpu::obp1>, &gpu::write_logged_register<&gpu::obp1> },
+				address_range_t<gpu>{ 0xFF4A, 0xFF4A, &gpu::read_member<&gpu::wy>, &gpu::write_logged_member<&gpu::wy> },
+				address_range_t<gpu>{ 0xFF4B, 0xFF4B, &gpu::read_member<&gpu::wx>, &gpu::write_logged_member<&gpu::wx> }
 			};
 		};
 
 	private:
+		friend class ppu_worker;
 
 		read_fn_t* read_fn = nullptr;
 		write_fn_t* write_fn = nullptr;
 
+		deferred_renderer* m_deferred = nullptr;
+		std::vector<ppu_log_entry> m_log;
+
+		// flush the log early if the LCD stays off for a long time
+		constexpr static std::size_t max_log_entries = 0x10000;
+
+		constexpr std::uint32_t frame_dot() const;
+		constexpr void record(uint16_t addr, uint8_t value, std::uint8_t line = 0);
+		constexpr void submit_log(bool frame_complete);
+
 		template<auto RegisterPtr>
 		constexpr uint8_t read_register([[maybe_unused]] uint16_t addr) {
 			return (this->*RegisterPtr).read();
@@ -58,11 +200,29 @@ namespace yahbog {
 			this->*MemberPtr = value;
 		}
 
+		template<auto RegisterPtr>
+		constexpr void write_logged_register(uint16_t addr, uint8_t value) {
+			record(addr, value);
+			(this->*RegisterPtr).write(value);
+		}
+
+		template<auto MemberPtr>
+		constexpr void write_logged_member(uint16_t addr, uint8_t value) {
+			record(addr, value);
+			this->*MemberPtr = value;
+		}
+
+		constexpr void write_readonly([[maybe_unused]] uint16_t addr, [[maybe_unused]] uint8_t value) {}
+
+		constexpr void write_lcdc(uint16_t addr, uint8_t value);
+		constexpr void write_stat(uint16_t addr, uint8_t value);
+
 		constexpr uint8_t read_vram(uint16_t addr) {
 			return vram[addr - 0x8000];
 		}
 
 		constexpr void write_vram(uint16_t addr, uint8_t value) {
+			record(addr, value);
 			vram[addr - 0x8000] = value;
 		}
 
@@ -71,10 +231,24 @@ namespace yahbog {
 		}
 
 		constexpr void write_oam(uint16_t addr, uint8_t value) {
+			record(addr, value);
 			oam[addr - 0xFE00] = value;
+
+			// only the Y coordinate decides which lines a sprite lands on
+			if ((addr & 0b11) == 0) {
+				oam_dirty = true;
+			}
 		}
 
+		constexpr void write_dma(uint16_t addr, uint8_t value);
+
+		constexpr bool window_visible() const;
+		constexpr void end_scanline();
 		constexpr void render_scanline();
+		constexpr void write_line(std::span<const std::uint8_t, 160> shades);
+		constexpr void render_sprites(std::span<const std::uint8_t, 160> bg, std::span<std::uint8_t, 160> shades);
+		constexpr void build_sprite_index();
+		constexpr std::uint8_t update_stat();
 
 		enum class mode_t {
 			hblank = 0,
@@ -86,14 +260,39 @@ namespace yahbog {
 		std::size_t mode_clock = 0;
 		mode_t mode = mode_t::oam;
 
-		constexpr static std::size_t bpp = 2;
-		constexpr static auto framebuffer_size = 160 * 144 / (8 / bpp);
+		std::size_t m_frames = 0;
+
+		// internal line counter of the window, only advanced on lines where it was drawn
+		std::uint8_t window_line = 0;
 
-		std::array<std::uint8_t, framebuffer_size> m_framebuffer{};
+		// the STAT interrupt fires on the rising edge of this line
+		bool stat_line = false;
+
+		framebuffer_t m_framebuffer{};
+		bool m_frame_ready = false;
+
+		frame_output m_output{};
+		bool m_has_output = false;
+		std::size_t m_line_bytes = 0;
+		std::size_t m_stride = 0;
+		// index of the buffer currently being drawn
+		std::uint8_t m_back = 0;
+
+		bool m_hashing = true;
+		xxhash64 m_line_hasher{};
+		std::uint64_t m_frame_hash = 0;
 
 		std::array<std::uint8_t, 0x2000> vram{};
 		std::array<std::uint8_t, 0xA0> oam{};
 
+		constexpr static std::size_t oam_entries = 40;
+		constexpr static std::size_t sprites_per_line = 10;
+
+		// bit N of sprite_lines[y] is set when OAM entry N overlaps line y;
+		// rebuilt lazily after a Y coordinate, the sprite size or DMA changes it
+		std::array<std::uint64_t, screen_height> sprite_lines{};
+		bool oam_dirty = true;
+
 		struct lcdc_t {
 			constexpr static std::uint8_t read_mask = 0xFF;
 			constexpr static std::uint8_t write_mask = 0xFF;
@@ -155,4 +354,6 @@ namespace yahbog {
 		std::uint8_t wx{};
 
 	};
-}
\ No newline at end of file
+}
+
+#include <yahbog/impl/ppu_impl.h>
\ No newline at end of file
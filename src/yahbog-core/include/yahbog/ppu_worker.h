@@ -0,0 +1,65 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <yahbog/ppu.h>
+
+namespace yahbog {
+
+	// Rasterizes frames on a second thread. While attached, the gpu only logs the
+	// writes that affect rendering; the worker replays frame N's log against its own
+	// copy of VRAM, OAM and the registers while the CPU thread emulates frame N+1.
+	// Lines are drawn at the same points of the write stream as inline rendering,
+	// so the output is bit-identical.
+	class ppu_worker final : public deferred_renderer {
+	public:
+		// Attaches to source, which must outlive the worker
+		explicit ppu_worker(gpu& source);
+
+		// Rasterizes what was logged of the current frame and hands rendering back
+		// to source, which finishes the frame inline
+		~ppu_worker() override;
+
+		ppu_worker(const ppu_worker&) = delete;
+		ppu_worker& operator=(const ppu_worker&) = delete;
+
+		void submit(std::vector<ppu_log_entry>& log, bool frame_complete) override;
+
+		// Blocks until every submitted frame is rasterized, then makes the latest
+		// one visible through gpu::framebuffer() or gpu::front_buffer(). The front
+		// buffer of a frame_output stays valid until the next frame is submitted.
+		void sync();
+
+		// Copies the most recently rasterized packed frame into out and returns how
+		// many frames have been rasterized so far. Never blocks on the worker. Not
+		// maintained while the gpu draws into a frame_output.
+		std::size_t latest(gpu::framebuffer_t& out) const;
+
+		std::size_t frames_rendered() const;
+
+	private:
+		void run(std::stop_token stop);
+
+		gpu& m_source;
+		std::unique_ptr<gpu> m_shadow;
+
+		// owned by the worker while m_busy is set
+		std::vector<ppu_log_entry> m_pending;
+		bool m_pending_frame = false;
+		bool m_busy = false;
+
+		gpu::framebuffer_t m_front{};
+		std::size_t m_rendered = 0;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable_any m_work_cv;
+		std::condition_variable m_idle_cv;
+
+		std::jthread m_thread;
+	};
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <yahbog/emulator.h>
+
+namespace yahbog {
+
+	struct ram_range {
+		std::uint16_t start;
+		std::uint16_t length;
+	};
+
+	// A list of address ranges compiled once into block copies out of WRAM, HRAM,
+	// VRAM, OAM and external RAM, for reading the same bytes after every step.
+	// Neighbouring ranges in the same memory merge into one copy; only registers
+	// are still read through the bus, and open bus reads as 0xFF like peek_span.
+	class ram_gather {
+	public:
+		// Throws std::invalid_argument if a range leaves the address space
+		explicit ram_gather(std::span<const ram_range> ranges);
+
+		// Total bytes of all ranges
+		std::size_t size() const noexcept { return m_size; }
+
+		// Copies out the ranges back to back, in order, as the bus would read
+		// them. Throws std::invalid_argument if out does not hold size() bytes.
+		void gather(emulator& emu, std::span<std::uint8_t> out) const;
+
+	private:
+		struct segment {
+			emulator::memory_region region;
+			std::uint16_t address;
+			std::uint16_t offset;
+			std::uint16_t length;
+			std::uint32_t out;
+		};
+
+		std::vector<segment> m_segments;
+		std::size_t m_size = 0;
+	};
+
+}
@@ -4,6 +4,16 @@
 #include <bit>
 
 namespace yahbog {
+
+	// bits shared by the IE and IF registers
+	namespace interrupt {
+		constexpr std::uint8_t vblank   = 1 << 0;
+		constexpr std::uint8_t lcd_stat = 1 << 1;
+		constexpr std::uint8_t timer    = 1 << 2;
+		constexpr std::uint8_t serial   = 1 << 3;
+		constexpr std::uint8_t joypad   = 1 << 4;
+	}
+
 	struct registers {
 
 		std::uint8_t a = 0;
@@ -56,7 +66,7 @@ namespace yahbog {
 
 		std::uint8_t halted = 0;
 
-		void reset() {
+		constexpr void reset() {
 			a = 0x01;
 			f = 0xB0;
 			b = 0x00;
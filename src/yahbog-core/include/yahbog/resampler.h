@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <yahbog/apu.h>
+#include <yahbog/utility/simd.h>
+
+namespace yahbog {
+
+	// Converts the APU's stereo output to a host rate with a polyphase
+	// Blackman-windowed sinc filter. The inner product runs on AVX2 or SSE2 when
+	// available; it is computed in fixed point, so every level produces exactly
+	// the same samples.
+	class resampler {
+	public:
+		constexpr static std::size_t taps = 32;
+		constexpr static int phase_bits = 8;
+		constexpr static std::size_t phases = std::size_t{ 1 } << phase_bits;
+
+		// fraction bits of the filter coefficients; the taps of every phase sum to
+		// exactly 1 << coefficient_bits
+		constexpr static int coefficient_bits = 14;
+
+		// Throws std::invalid_argument if either rate is zero
+		explicit resampler(std::uint32_t output_rate, std::uint32_t input_rate = apu::sample_rate, simd::level level = simd::best());
+
+		// Appends interleaved left/right frames at the input rate
+		void push(std::span<const std::int16_t> frames);
+
+		// Moves everything the APU has synthesized so far into the resampler
+		void push(apu& source);
+
+		// Output frames that can be pulled right now
+		std::size_t frames_available() const noexcept;
+
+		// Writes up to out.size() / 2 interleaved left/right frames at the output
+		// rate and returns the number of frames written. Floats are in [-1, 1).
+		std::size_t pull(std::span<std::int16_t> out);
+		std::size_t pull(std::span<float> out);
+
+		// Forgets all buffered input
+		void clear() noexcept;
+
+		std::uint32_t output_rate() const noexcept { return m_output_rate; }
+		std::uint32_t input_rate() const noexcept { return m_input_rate; }
+		simd::level level() const noexcept { return m_level; }
+
+	private:
+		using kernel_t = std::array<std::int16_t, taps>;
+		using filter_fn = void(*)(const std::int16_t* kernel, const std::int16_t* left, const std::int16_t* right, std::int32_t* out);
+
+		template<typename T>
+		std::size_t pull_frames(std::span<T> out);
+
+		// 32.32 fixed point, in input samples
+		constexpr static int frac_bits = 32;
+
+		std::uint32_t m_output_rate;
+		std::uint32_t m_input_rate;
+		simd::level m_level;
+		filter_fn m_filter;
+
+		std::vector<kernel_t> m_kernels;
+		std::uint64_t m_step;
+		// position of the next output frame relative to m_left[0]
+		std::uint64_t m_position = 0;
+
+		// planar history, so one kernel row can be applied to both channels
+		std::vector<std::int16_t> m_left;
+		std::vector<std::int16_t> m_right;
+
+		std::vector<std::int16_t> m_scratch;
+	};
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include <yahbog/emulator.h>
+
+namespace yahbog {
+
+	// Keeps recent savestates in a fixed memory budget. Every keyframe_interval-th
+	// snapshot is stored whole and the rest as the XOR against the snapshot
+	// before them, both run-length encoded. The newest state is also kept
+	// decoded, so stepping back through deltas costs one decode each; only
+	// crossing a keyframe replays the deltas of the group before it.
+	class rewind_buffer {
+	public:
+		// Throws std::invalid_argument if the budget or the interval is zero
+		explicit rewind_buffer(std::size_t budget_bytes, std::size_t keyframe_interval = 60);
+
+		// Snapshots emu, evicting the oldest keyframe groups to make room. Returns
+		// false if a single snapshot does not fit the budget.
+		bool push(emulator& emu);
+
+		// Restores the newest snapshot and drops it, so repeated calls walk back
+		// one snapshot at a time. Returns false when nothing is left.
+		bool rewind(emulator& emu);
+
+		std::size_t size() const noexcept { return m_entries.size(); }
+		bool empty() const noexcept { return m_entries.empty(); }
+		std::size_t bytes_used() const noexcept;
+		std::size_t budget() const noexcept { return m_storage.size(); }
+
+		void clear() noexcept;
+
+	private:
+		struct entry {
+			std::size_t offset;
+			std::size_t length;
+			std::size_t state_size;
+			bool keyframe;
+		};
+
+		// Finds room for length bytes after the newest entry; false if the budget
+		// cannot hold it even when empty
+		bool allocate(std::size_t length, std::size_t& offset);
+		void evict_oldest_group();
+
+		// Rebuilds m_newest from the keyframe of the newest entry's group
+		void reconstruct_newest();
+
+		std::vector<std::byte> m_storage;
+		std::deque<entry> m_entries;
+		std::size_t m_keyframe_interval;
+		std::size_t m_since_keyframe = 0;
+
+		std::vector<std::byte> m_newest;
+		std::vector<std::byte> m_current;
+		std::vector<std::byte> m_delta;
+		std::vector<std::byte> m_encoded;
+	};
+
+}
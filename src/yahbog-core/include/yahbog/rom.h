@@ -1,11 +1,14 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <span>
 #include <filesystem>
+#include <memory>
 #include <vector>
 
 #include <yahbog/mmu.h>
+#include <yahbog/utility/xxhash.h>
 
 namespace yahbog {
 
@@ -25,7 +28,7 @@ namespace yahbog {
 		std::uint8_t version;
 		std::uint8_t checksum;
 
-		constexpr static rom_header_t from_bytes(std::span<std::uint8_t> data);
+		constexpr static rom_header_t from_bytes(std::span<const std::uint8_t> data);
 	};
 
 	class rom_t {
@@ -63,8 +66,32 @@ namespace yahbog {
 
 		constexpr const rom_header_t& header() const { return header_; }
 
+		// xxhash64 of the loaded ROM image, used to match savestates to their ROM
+		constexpr std::uint64_t hash() const { return rom_hash; }
+
+		// Bank selection and external RAM; the ROM image is not part of a state
+		template<typename IO>
+		void serialize(IO& io) {
+			io(rom_bank);
+			io(ram_bank);
+			io.bytes(ext_ram.data(), ext_ram.size());
+		}
+
 		bool load_rom(const std::filesystem::path& path);
-		constexpr bool load_rom(std::vector<std::uint8_t>&& data);
+		bool load_rom(std::vector<std::uint8_t>&& data);
+
+		// Uses an image that other rom_t instances may share; it is never modified
+		bool load_rom(std::shared_ptr<const std::vector<std::uint8_t>> image);
+
+		constexpr const std::shared_ptr<const std::vector<std::uint8_t>>& image() const { return rom_image; }
+
+		// The external RAM bank mapped at 0xA000, empty while RAM is disabled
+		constexpr std::span<std::uint8_t> mapped_ram() {
+			if (!ram_enabled() || ram_bank * ram_bank_size >= ext_ram.size()) {
+				return {};
+			}
+			return std::span(ext_ram).subspan(ram_bank * ram_bank_size).first((std::min<std::size_t>)(ram_bank_size, ext_ram.size() - ram_bank * ram_bank_size));
+		}
 
 	private:
 
@@ -73,10 +100,13 @@ namespace yahbog {
 		constexpr static auto rom_bank_size = 0x4000; // 16KB
 		constexpr static auto ram_bank_size = 0x2000; // 8KB
 
-		std::vector<std::uint8_t> rom_data;
+		// copies of a rom_t share the image; rom_data views it
+		std::shared_ptr<const std::vector<std::uint8_t>> rom_image;
+		std::span<const std::uint8_t> rom_data;
 		std::vector<std::uint8_t> ext_ram;
 		rom_header_t header_;
 		std::size_t rom_bank;
+		std::uint64_t rom_hash = 0;
 		std::size_t ram_bank = (std::numeric_limits<std::size_t>::max)();
 	};
 
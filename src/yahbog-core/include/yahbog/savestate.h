@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#include <yahbog/utility/xxhash.h>
+
+namespace yahbog {
+
+	// Leads every savestate. What follows is the member data of each component in
+	// a fixed order, copied as-is, so saving and restoring are a run of memcpys.
+	// States are only portable between builds with the same layout.
+	struct state_header {
+		constexpr static std::uint32_t expected_magic = 0x53424859; // "YHBS"
+		constexpr static std::uint32_t current_version = 2;
+
+		std::uint32_t magic = expected_magic;
+		std::uint32_t version = current_version;
+
+		// xxhash64 of the ROM the state belongs to; the ROM itself is not stored
+		std::uint64_t rom_hash = 0;
+
+		// bytes including this header
+		std::uint64_t size = 0;
+	};
+
+	// The visitors below are passed to each component's serialize(io), which
+	// lists its state once for saving, loading, sizing, validating and hashing.
+	// Pointers, hooks and host-side configuration are never part of a state.
+	// Values that decide what follows them, such as a count, go through
+	// io.layout() so the validator can read them. Visitors with emulated_only set
+	// skip what only the host sees, such as undrained samples and the framebuffer.
+
+	class state_writer {
+	public:
+		constexpr static bool loading = false;
+		constexpr static bool emulated_only = false;
+
+		explicit state_writer(std::span<std::byte> out) noexcept : m_out(out) {}
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		void operator()(const T& value) {
+			bytes(&value, sizeof(T));
+		}
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		void layout(const T& value) {
+			(*this)(value);
+		}
+
+		void bytes(const void* data, std::size_t size) {
+			if (size > m_out.size() - m_pos) {
+				throw std::out_of_range(std::format("Savestate needs more than {} bytes", m_out.size()));
+			}
+			std::memcpy(m_out.data() + m_pos, data, size);
+			m_pos += size;
+		}
+
+		std::size_t position() const noexcept { return m_pos; }
+
+	private:
+		std::span<std::byte> m_out;
+		std::size_t m_pos = 0;
+	};
+
+	class state_reader {
+	public:
+		constexpr static bool loading = true;
+		constexpr static bool emulated_only = false;
+
+		explicit state_reader(std::span<const std::byte> in) noexcept : m_in(in) {}
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		void operator()(T& value) {
+			bytes(&value, sizeof(T));
+		}
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		void layout(T& value) {
+			(*this)(value);
+		}
+
+		void bytes(void* data, std::size_t size) {
+			std::memcpy(data, m_in.data() + m_pos, size);
+			skip(size);
+		}
+
+		void skip(std::size_t size) {
+			if (size > m_in.size() - m_pos) {
+				throw std::invalid_argument(std::format("Savestate is truncated at {} bytes", m_in.size()));
+			}
+			m_pos += size;
+		}
+
+		std::size_t position() const noexcept { return m_pos; }
+
+	private:
+		std::span<const std::byte> m_in;
+		std::size_t m_pos = 0;
+	};
+
+	class state_sizer {
+	public:
+		constexpr static bool loading = false;
+		constexpr static bool emulated_only = false;
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		constexpr void operator()(const T&) noexcept {
+			m_pos += sizeof(T);
+		}
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		constexpr void layout(const T& value) noexcept {
+			(*this)(value);
+		}
+
+		constexpr void bytes(const void*, std::size_t size) noexcept {
+			m_pos += size;
+		}
+
+		constexpr std::size_t position() const noexcept { return m_pos; }
+
+	private:
+		std::size_t m_pos = 0;
+	};
+
+	// Walks a state without loading it: member data is only bounds-checked, and
+	// layout values are read so the walk follows the state's own shape. A body
+	// the validator gets through in exactly its size loads without throwing.
+	class state_validator {
+	public:
+		constexpr static bool loading = false;
+		constexpr static bool emulated_only = false;
+
+		explicit state_validator(std::span<const std::byte> in) noexcept : m_reader(in) {}
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		void operator()(const T&) {
+			m_reader.skip(sizeof(T));
+		}
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		void layout(T& value) {
+			m_reader(value);
+		}
+
+		void bytes(const void*, std::size_t size) {
+			m_reader.skip(size);
+		}
+
+		std::size_t position() const noexcept { return m_reader.position(); }
+
+	private:
+		state_reader m_reader;
+	};
+
+	// Hashes the emulated machine, so emulators that ran the same inputs from the
+	// same state compare equal whatever their audio, rendering and threading setup
+	class state_hasher {
+	public:
+		constexpr static bool loading = false;
+		constexpr static bool emulated_only = true;
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		void operator()(const T& value) noexcept {
+			bytes(&value, sizeof(T));
+		}
+
+		template<typename T> requires std::is_trivially_copyable_v<T>
+		void layout(const T& value) noexcept {
+			(*this)(value);
+		}
+
+		void bytes(const void* data, std::size_t size) noexcept {
+			m_hasher.update({ static_cast<const std::uint8_t*>(data), size });
+		}
+
+		constexpr std::uint64_t digest() const noexcept { return m_hasher.digest(); }
+
+	private:
+		xxhash64 m_hasher;
+	};
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace yahbog {
+
+	// Persistent workers for data-parallel loops. Each parallel_for hands every
+	// worker, and the calling thread, a contiguous share of the indices as its
+	// own deque; a thread that runs out steals from the far end of another's,
+	// so uneven tasks still balance without a shared queue. Nothing is
+	// allocated per loop.
+	class thread_pool {
+	public:
+		// threads counts the calling thread; 0 uses one per hardware thread. With
+		// pin_threads, worker i is bound to core i where the platform allows it;
+		// the calling thread's affinity is left alone.
+		explicit thread_pool(std::size_t threads = 0, bool pin_threads = false);
+		~thread_pool();
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		// Calls task(i) for every i in [0, count) and returns once all are done.
+		// If tasks throw, the rest still run and the first exception is rethrown.
+		// Not reentrant: tasks must not call parallel_for on the same pool.
+		void parallel_for(std::size_t count, const std::function<void(std::size_t)>& task);
+
+		std::size_t size() const noexcept { return m_queues.size(); }
+
+	private:
+		// the indices [begin, end) left to run; the owner takes from the front
+		struct queue {
+			std::mutex lock;
+			std::size_t begin = 0;
+			std::size_t end = 0;
+		};
+
+		void worker(std::size_t slot, std::stop_token stop);
+
+		// Runs tasks from the slot's own queue, then stolen ones, until none are left
+		void drain(std::size_t slot);
+		bool pop(std::size_t slot, std::size_t& index);
+		bool steal(std::size_t thief, std::size_t& index);
+
+		std::vector<std::unique_ptr<queue>> m_queues;
+
+		const std::function<void(std::size_t)>* m_task = nullptr;
+		std::atomic<std::size_t> m_remaining = 0;
+
+		std::mutex m_error_lock;
+		std::exception_ptr m_error;
+
+		std::mutex m_wake_lock;
+		std::condition_variable_any m_wake;
+		std::uint64_t m_generation = 0;
+
+		std::vector<std::jthread> m_threads;
+	};
+
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <algorithm>
+#include <stdexcept>
+
+namespace yahbog {
+
+	namespace detail {
+		constexpr double pi = 3.14159265358979323846;
+
+		// Taylor series after reducing to [-pi, pi]; only used to build tables
+		constexpr double sin_approx(double x) {
+			while (x > pi) x -= 2 * pi;
+			while (x < -pi) x += 2 * pi;
+
+			double term = x, sum = x;
+			for (int n = 1; n < 12; n++) {
+				term *= -x * x / ((2 * n) * (2 * n + 1));
+				sum += term;
+			}
+			return sum;
+		}
+
+		constexpr double cos_approx(double x) {
+			return sin_approx(x + pi / 2);
+		}
+
+		constexpr double sinc(double x) {
+			return x == 0.0 ? 1.0 : sin_approx(pi * x) / (pi * x);
+		}
+	}
+
+	// Band-limited step synthesis: amplitude changes are inserted as windowed-sinc
+	// impulses into a delta buffer and integrated only when samples are read, so the
+	// cost is proportional to the number of transitions plus the samples produced,
+	// not to the number of emulated cycles.
+	class blip_buffer {
+	public:
+		// input clocks (T-cycles) per output sample; 4194304 / 64 = 65536 Hz
+		constexpr static std::size_t clocks_per_sample = 64;
+		constexpr static std::size_t phases = 32;
+		constexpr static std::size_t taps = 16;
+		constexpr static std::size_t capacity = 8192;
+
+		constexpr static int delta_bits = 15;
+		constexpr static int bass_shift = 9;
+
+		// Inserts an amplitude step at an absolute clock; time must not precede
+		// the samples already read and must fit in the buffer (see room_until)
+		constexpr void add_delta(std::uint64_t time, std::int32_t delta) {
+			const auto offset = time - m_start;
+			const auto pos = offset / clocks_per_sample;
+			const auto phase = (offset % clocks_per_sample) * phases / clocks_per_sample;
+
+			const auto& kernel = step_kernel[phase];
+			for (std::size_t i = 0; i < taps; i++) {
+				m_deltas[pos + i] += delta * kernel[i];
+			}
+		}
+
+		// Latest clock that can be passed to add_delta without reading or discarding
+		constexpr std::uint64_t room_until() const {
+			return m_start + (capacity - taps) * clocks_per_sample - 1;
+		}
+
+		// Samples that no future delta at or after time can change any more
+		constexpr std::size_t samples_ready(std::uint64_t time) const {
+			return static_cast<std::size_t>((time - m_start) / clocks_per_sample);
+		}
+
+		// Integrates count samples into out[0], out[stride], ... and drops them
+		constexpr void read(std::span<std::int16_t> out, std::size_t count, std::size_t stride) {
+			for (std::size_t i = 0; i < count; i++) {
+				auto s = static_cast<std::int32_t>(m_sum >> delta_bits);
+				m_sum += m_deltas[i];
+				s = std::clamp(s, -32768, 32767);
+				out[i * stride] = static_cast<std::int16_t>(s);
+				m_sum -= static_cast<std::int64_t>(s) << (delta_bits - bass_shift);
+			}
+			remove(count);
+		}
+
+		// Integrates and drops count samples without producing output
+		constexpr void discard(std::size_t count) {
+			for (std::size_t i = 0; i < count; i++) {
+				auto s = static_cast<std::int32_t>(m_sum >> delta_bits);
+				m_sum += m_deltas[i];
+				s = std::clamp(s, -32768, 32767);
+				m_sum -= static_cast<std::int64_t>(s) << (delta_bits - bass_shift);
+			}
+			remove(count);
+		}
+
+		constexpr void clear(std::uint64_t start) {
+			m_deltas.fill(0);
+			m_sum = 0;
+			m_start = start;
+		}
+
+		constexpr std::uint64_t start() const { return m_start; }
+
+		// Stores only the deltas that deltas up to time can have touched
+		template<typename IO>
+		void serialize(IO& io, std::uint64_t time) {
+			io(m_start);
+			io(m_sum);
+
+			auto used = static_cast<std::uint32_t>((std::min)(capacity, samples_ready(time) + taps));
+			io.layout(used);
+			if (used > capacity) {
+				throw std::invalid_argument("Savestate has a corrupt sample buffer");
+			}
+
+			io.bytes(m_deltas.data(), used * sizeof(m_deltas[0]));
+			if constexpr (IO::loading) {
+				std::fill(m_deltas.begin() + used, m_deltas.end(), 0);
+			}
+		}
+
+	private:
+		constexpr void remove(std::size_t count) {
+			std::copy(m_deltas.begin() + count, m_deltas.end(), m_deltas.begin());
+			std::fill(m_deltas.end() - count, m_deltas.end(), 0);
+			m_start += count * clocks_per_sample;
+		}
+
+		using kernel_t = std::array<std::array<std::int32_t, taps>, phases>;
+
+		// impulse responses of a band-limited step for each sub-sample phase,
+		// Blackman windowed and normalised so each phase sums to exactly 1 << delta_bits
+		constexpr static kernel_t step_kernel = []() {
+			kernel_t table{};
+			constexpr double cutoff = 0.9;
+
+			for (std::size_t p = 0; p < phases; p++) {
+				std::array<double, taps> h{};
+				double total = 0;
+
+				for (std::size_t i = 0; i < taps; i++) {
+					const double x = static_cast<double>(i) - (taps / 2 - 1) - static_cast<double>(p) / phases;
+					const double w = static_cast<double>(i) + 1.0 - static_cast<double>(p) / phases;
+					const double window = 0.42
+						- 0.5 * detail::cos_approx(2 * detail::pi * w / (taps + 1))
+						+ 0.08 * detail::cos_approx(4 * detail::pi * w / (taps + 1));
+
+					h[i] = cutoff * detail::sinc(cutoff * x) * window;
+					total += h[i];
+				}
+
+				std::int32_t sum = 0;
+				for (std::size_t i = 0; i < taps; i++) {
+					const double scaled = h[i] / total * (1 << delta_bits);
+					table[p][i] = static_cast<std::int32_t>(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+					sum += table[p][i];
+				}
+
+				// put the rounding error on the centre tap so steps settle exactly
+				table[p][taps / 2] += (1 << delta_bits) - sum;
+			}
+
+			return table;
+		}();
+
+		std::array<std::int32_t, capacity> m_deltas{};
+		std::int64_t m_sum = 0;
+		std::uint64_t m_start = 0;
+	};
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define YAHBOG_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Lets a single function use instructions beyond the baseline the TU is compiled
+// for; callers must check simd::best() first. MSVC needs no attribute.
+#if defined(YAHBOG_X86) && (defined(__GNUC__) || defined(__clang__))
+#define YAHBOG_TARGET(features) __attribute__((target(features)))
+#else
+#define YAHBOG_TARGET(features)
+#endif
+
+namespace yahbog::simd {
+
+	enum class level : std::uint8_t {
+		scalar,
+		sse2,
+		avx2 // implies FMA
+	};
+
+	// Highest instruction set usable on this CPU and OS
+	inline level detect() noexcept {
+#if defined(YAHBOG_X86) && defined(_MSC_VER)
+		int info[4]{};
+		__cpuid(info, 0);
+		const int max_leaf = info[0];
+
+		__cpuid(info, 1);
+		const bool sse2 = (info[3] >> 26) & 1;
+		const bool fma = (info[2] >> 12) & 1;
+		const bool osxsave = (info[2] >> 27) & 1;
+		const bool avx_state = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+
+		bool avx2 = false;
+		if (max_leaf >= 7) {
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] >> 5) & 1;
+		}
+
+		if (avx2 && fma && avx_state) {
+			return level::avx2;
+		}
+		return sse2 ? level::sse2 : level::scalar;
+#elif defined(YAHBOG_X86)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+			return level::avx2;
+		}
+		return __builtin_cpu_supports("sse2") ? level::sse2 : level::scalar;
+#else
+		return level::scalar;
+#endif
+	}
+
+	// detect(), evaluated once
+	inline level best() noexcept {
+		static const level cached = detect();
+		return cached;
+	}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace yahbog {
+
+	// LEB128: seven bits per byte, low bits first, high bit set on all but the last
+	inline void put_varint(std::vector<std::byte>& out, std::uint64_t value) {
+		while (value >= 0x80) {
+			out.push_back(static_cast<std::byte>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<std::byte>(value));
+	}
+
+	// Decodes one value and advances p past it. Returns false, leaving p where it
+	// was, if the value runs past end or does not fit 64 bits.
+	constexpr bool get_varint(const std::byte*& p, const std::byte* end, std::uint64_t& value) noexcept {
+		std::uint64_t result = 0;
+		for (auto q = p; q < end && q - p < 10; q++) {
+			const auto b = std::to_integer<std::uint64_t>(*q);
+			result |= (b & 0x7F) << ((q - p) * 7);
+			if (!(b & 0x80)) {
+				value = result;
+				p = q + 1;
+				return true;
+			}
+		}
+		return false;
+	}
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+
+namespace yahbog {
+
+	// Streaming XXH64, usable in constant expressions
+	class xxhash64 {
+	public:
+		constexpr explicit xxhash64(std::uint64_t seed = 0) noexcept { reset(seed); }
+
+		constexpr void reset(std::uint64_t seed = 0) noexcept {
+			m_seed = seed;
+			m_acc = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+			m_total = 0;
+			m_buffered = 0;
+		}
+
+		constexpr void update(std::span<const std::uint8_t> data) noexcept {
+			std::size_t pos = 0;
+			m_total += data.size();
+
+			if (m_buffered > 0) {
+				while (m_buffered < stripe_size && pos < data.size()) {
+					m_buffer[m_buffered++] = data[pos++];
+				}
+
+				if (m_buffered < stripe_size) {
+					return;
+				}
+
+				consume_stripe(m_buffer.data());
+				m_buffered = 0;
+			}
+
+			for (; pos + stripe_size <= data.size(); pos += stripe_size) {
+				consume_stripe(data.data() + pos);
+			}
+
+			while (pos < data.size()) {
+				m_buffer[m_buffered++] = data[pos++];
+			}
+		}
+
+		constexpr std::uint64_t digest() const noexcept {
+			std::uint64_t h;
+			if (m_total >= stripe_size) {
+				h = std::rotl(m_acc[0], 1) + std::rotl(m_acc[1], 7) + std::rotl(m_acc[2], 12) + std::rotl(m_acc[3], 18);
+				for (auto acc : m_acc) {
+					h = merge_round(h, acc);
+				}
+			}
+			else {
+				h = m_seed + prime5;
+			}
+
+			h += m_total;
+
+			std::size_t pos = 0;
+			for (; pos + 8 <= m_buffered; pos += 8) {
+				h ^= round(0, read64(m_buffer.data() + pos));
+				h = std::rotl(h, 27) * prime1 + prime4;
+			}
+
+			if (pos + 4 <= m_buffered) {
+				h ^= read32(m_buffer.data() + pos) * prime1;
+				h = std::rotl(h, 23) * prime2 + prime3;
+				pos += 4;
+			}
+
+			for (; pos < m_buffered; pos++) {
+				h ^= m_buffer[pos] * prime5;
+				h = std::rotl(h, 11) * prime1;
+			}
+
+			h ^= h >> 33;
+			h *= prime2;
+			h ^= h >> 29;
+			h *= prime3;
+			h ^= h >> 32;
+			return h;
+		}
+
+	private:
+		constexpr static std::uint64_t prime1 = 0x9E3779B185EBCA87ull;
+		constexpr static std::uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+		constexpr static std::uint64_t prime3 = 0x165667B19E3779F9ull;
+		constexpr static std::uint64_t prime4 = 0x85EBCA77C2B2AE63ull;
+		constexpr static std::uint64_t prime5 = 0x27D4EB2F165667C5ull;
+
+		constexpr static std::size_t stripe_size = 32;
+
+		constexpr static std::uint64_t read64(const std::uint8_t* p) noexcept {
+			std::uint64_t v = 0;
+			for (int i = 7; i >= 0; i--) {
+				v = (v << 8) | p[i];
+			}
+			return v;
+		}
+
+		constexpr static std::uint64_t read32(const std::uint8_t* p) noexcept {
+			return std::uint64_t(p[0]) | (std::uint64_t(p[1]) << 8) | (std::uint64_t(p[2]) << 16) | (std::uint64_t(p[3]) << 24);
+		}
+
+		constexpr static std::uint64_t round(std::uint64_t acc, std::uint64_t input) noexcept {
+			acc += input * prime2;
+			acc = std::rotl(acc, 31);
+			return acc * prime1;
+		}
+
+		constexpr static std::uint64_t merge_round(std::uint64_t acc, std::uint64_t val) noexcept {
+			acc ^= round(0, val);
+			return acc * prime1 + prime4;
+		}
+
+		constexpr void consume_stripe(const std::uint8_t* p) noexcept {
+			for (std::size_t i = 0; i < 4; i++) {
+				m_acc[i] = round(m_acc[i], read64(p + i * 8));
+			}
+		}
+
+		std::uint64_t m_seed = 0;
+		std::array<std::uint64_t, 4> m_acc{};
+		std::uint64_t m_total = 0;
+		std::array<std::uint8_t, stripe_size> m_buffer{};
+		std::size_t m_buffered = 0;
+	};
+
+	constexpr std::uint64_t xxhash64_of(std::span<const std::uint8_t> data, std::uint64_t seed = 0) noexcept {
+		xxhash64 h{ seed };
+		h.update(data);
+		return h.digest();
+	}
+
+	static_assert(xxhash64_of({}) == 0xEF46DB3751D8E999ull);
+	static_assert(xxhash64_of(std::array<std::uint8_t, 3>{ 'a', 'b', 'c' }) == 0x44BC2CF5AD770999ull);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <yahbog/emulator.h>
+#include <yahbog/ram_gather.h>
+#include <yahbog/thread_pool.h>
+
+namespace yahbog {
+
+	struct vector_env_options {
+		std::size_t envs = 1;
+
+		// passed to the thread_pool
+		std::size_t threads = 0;
+		bool pin_threads = false;
+
+		// An observation is the packed 2bpp frame, if enabled, followed by the
+		// bytes of each RAM range in order, as the bus would read them
+		bool frame = true;
+		std::vector<ram_range> ram;
+
+		// Episodes end after this many steps; 0 for no limit
+		std::size_t max_episode_steps = 0;
+
+		// Called after every step with the env's index, emulator and new
+		// observation; either may be left empty for no reward or no early
+		// termination. They run on pool threads, concurrently for different envs.
+		std::function<float(std::size_t, const emulator&, std::span<const std::uint8_t>)> reward;
+		std::function<bool(std::size_t, const emulator&, std::span<const std::uint8_t>)> done;
+	};
+
+	// A batch of environments over one ROM for reinforcement learning. Every env
+	// starts from the same snapshot; step runs one frame per env and writes
+	// observations, rewards and done flags into caller-owned contiguous buffers,
+	// so they can live in shared memory or a framework's tensor. Nothing is
+	// allocated per reset or step.
+	class vector_env {
+	public:
+		// Episodes start from prototype's current state. Throws
+		// std::invalid_argument if there are no envs or a RAM range leaves the
+		// address space.
+		vector_env(const emulator& prototype, vector_env_options options);
+
+		std::size_t size() const noexcept { return m_envs.size(); }
+		std::size_t observation_size() const noexcept { return m_observation_size; }
+
+		// Restarts the envs whose mask byte is non-zero, all of them if mask is
+		// empty, and writes their first observations. Throws std::invalid_argument
+		// if a buffer does not match size() or size() * observation_size().
+		void reset(std::span<const std::uint8_t> mask, std::span<std::uint8_t> observations);
+
+		// Presses actions[i] (a mask of button::*) on env i for one frame. An env
+		// whose episode ends reports done and restarts at once, so its observation
+		// is the first of the next episode. Throws like reset.
+		void step(std::span<const std::uint8_t> actions, std::span<std::uint8_t> observations,
+			std::span<float> rewards, std::span<std::uint8_t> dones);
+
+		emulator& operator[](std::size_t i) { return *m_envs[i].emu; }
+
+	private:
+		struct env {
+			std::unique_ptr<emulator> emu;
+			std::size_t steps = 0;
+		};
+
+		void check_per_env(std::size_t size, std::string_view what) const;
+		void check_observations(std::span<const std::uint8_t> observations) const;
+
+		void restart(std::size_t i);
+		void observe(std::size_t i);
+		std::span<std::uint8_t> observation(std::size_t i) const;
+
+		vector_env_options m_options;
+		ram_gather m_gather;
+		std::size_t m_observation_size = 0;
+
+		std::vector<env> m_envs;
+		std::vector<std::byte> m_start;
+
+		// the buffers of the call in progress, read by the pool tasks below, which
+		// are built once so dispatching them does not allocate
+		std::span<const std::uint8_t> m_mask;
+		std::span<const std::uint8_t> m_actions;
+		std::span<std::uint8_t> m_observations;
+		std::span<float> m_rewards;
+		std::span<std::uint8_t> m_dones;
+
+		std::function<void(std::size_t)> m_reset_task;
+		std::function<void(std::size_t)> m_step_task;
+
+		thread_pool m_pool;
+	};
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+/* C interface to yahbog::vector_env for trainers and other languages' FFIs.
+ * Functions returning int return 0 on success and -1 on failure, and
+ * yahbog_last_error() then describes the failure on the calling thread. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct yahbog_vector_env yahbog_vector_env;
+
+typedef struct yahbog_ram_range {
+	uint16_t start;
+	uint16_t length;
+} yahbog_ram_range;
+
+/* Called with one env's observation after each step; may be NULL */
+typedef float (*yahbog_reward_fn)(void* user, size_t env, const uint8_t* observation, size_t size);
+typedef int (*yahbog_done_fn)(void* user, size_t env, const uint8_t* observation, size_t size);
+
+typedef struct yahbog_env_config {
+	size_t envs;
+	size_t threads;     /* 0 for one per hardware thread */
+	int pin_threads;
+
+	int frame;          /* include the packed 2bpp frame in observations */
+	const yahbog_ram_range* ram;
+	size_t ram_count;
+
+	size_t max_episode_steps; /* 0 for no limit */
+
+	/* Savestate to start episodes from; NULL for the post-boot state */
+	const void* start_state;
+	size_t start_state_size;
+
+	yahbog_reward_fn reward;
+	yahbog_done_fn done;
+	void* user;
+} yahbog_env_config;
+
+/* Returns NULL on failure */
+yahbog_vector_env* yahbog_vector_env_create(const char* rom_path, const yahbog_env_config* config);
+void yahbog_vector_env_destroy(yahbog_vector_env* env);
+
+size_t yahbog_vector_env_size(const yahbog_vector_env* env);
+size_t yahbog_vector_env_observation_size(const yahbog_vector_env* env);
+
+/* mask holds one byte per env, or is NULL to reset all. observations_size is
+ * the size of the observations buffer, which must be size * observation_size
+ * bytes; anything else fails. */
+int yahbog_vector_env_reset(yahbog_vector_env* env, const uint8_t* mask, uint8_t* observations, size_t observations_size);
+
+/* actions, rewards and dones hold one entry per env; observations is sized
+ * as for reset */
+int yahbog_vector_env_step(yahbog_vector_env* env, const uint8_t* actions, uint8_t* observations, size_t observations_size, float* rewards, uint8_t* dones);
+
+const char* yahbog_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
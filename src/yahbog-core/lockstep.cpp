@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <tuple>
+
+#include <yahbog/lockstep.h>
+
+namespace yahbog {
+
+	namespace {
+		// Cheap to compare, and different for nearly every pair of states that
+		// differ, so only groups agreeing on it are compared in full
+		auto merge_key(const emulator& emu) {
+			const auto& r = emu.z80.r();
+			return std::tuple{ emu.z80.cycles(), r.pc, r.sp, r.ir, r.mupc, r.af(), r.bc(), r.de(), r.hl() };
+		}
+	}
+
+	lockstep_runner::lockstep_runner(const emulator& prototype, std::size_t lanes)
+		: m_group_of(lanes), m_buttons(lanes) {
+
+		if (lanes == 0) {
+			return;
+		}
+
+		group all{ prototype.clone(), std::vector<std::size_t>(lanes) };
+		std::iota(all.lanes.begin(), all.lanes.end(), 0);
+		std::ranges::fill(m_buttons, prototype.pad.buttons());
+		m_groups.push_back(std::move(all));
+	}
+
+	void lockstep_runner::run_frame() {
+		step([](emulator& emu) { emu.run_frame(); });
+	}
+
+	void lockstep_runner::run_cycles(std::size_t cycles) {
+		step([cycles](emulator& emu) { emu.run_cycles(cycles); });
+	}
+
+	template<typename Step>
+	void lockstep_runner::step(Step run) {
+		split();
+
+		for (auto& g : m_groups) {
+			g.emu->set_buttons(m_buttons[g.lanes.front()]);
+			run(*g.emu);
+		}
+
+		merge();
+	}
+
+	void lockstep_runner::split() {
+		const auto existing = m_groups.size();
+		for (std::size_t i = 0; i < existing; i++) {
+			auto& lanes = m_groups[i].lanes;
+			const auto pressed = m_buttons[lanes.front()];
+
+			// lanes with the leader's buttons stay; the rest peel off by their buttons
+			auto stray = std::ranges::stable_partition(lanes, [&](std::size_t l) { return m_buttons[l] == pressed; }).begin();
+			if (stray == lanes.end()) {
+				continue;
+			}
+
+			std::vector<std::size_t> peeled(stray, lanes.end());
+			lanes.erase(stray, lanes.end());
+
+			std::ranges::stable_sort(peeled, {}, [&](std::size_t l) { return m_buttons[l]; });
+			for (auto first = peeled.begin(); first != peeled.end();) {
+				auto last = std::find_if(first, peeled.end(), [&](std::size_t l) { return m_buttons[l] != m_buttons[*first]; });
+				m_groups.push_back({ m_groups[i].emu->clone(), std::vector<std::size_t>(first, last) });
+				first = last;
+			}
+		}
+
+		if (m_groups.size() != existing) {
+			reindex();
+		}
+	}
+
+	void lockstep_runner::merge() {
+		if (m_groups.size() < 2) {
+			return;
+		}
+
+		std::vector<std::size_t> order(m_groups.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::ranges::sort(order, {}, [&](std::size_t g) { return merge_key(*m_groups[g].emu); });
+
+		bool merged = false;
+		for (auto first = order.begin(); first != order.end();) {
+			const auto key = merge_key(*m_groups[*first].emu);
+			auto last = std::find_if(first + 1, order.end(), [&](std::size_t g) { return merge_key(*m_groups[g].emu) != key; });
+
+			const auto candidates = static_cast<std::size_t>(last - first);
+			if (candidates > 1) {
+				if (m_states.size() < candidates) {
+					m_states.resize(candidates);
+				}
+				for (std::size_t c = 0; c < candidates; c++) {
+					auto& emu = *m_groups[first[c]].emu;
+					m_states[c].resize(emu.state_size());
+					m_states[c].resize(emu.save_state(m_states[c]));
+				}
+
+				// fold every candidate into the first earlier one with the same state
+				for (std::size_t c = 1; c < candidates; c++) {
+					for (std::size_t into = 0; into < c; into++) {
+						auto& target = m_groups[first[into]];
+						if (target.emu && m_states[into] == m_states[c]) {
+							auto& source = m_groups[first[c]];
+							target.lanes.insert(target.lanes.end(), source.lanes.begin(), source.lanes.end());
+							source.emu.reset();
+							merged = true;
+							break;
+						}
+					}
+				}
+			}
+			first = last;
+		}
+
+		if (merged) {
+			std::erase_if(m_groups, [](const group& g) { return !g.emu; });
+			reindex();
+		}
+	}
+
+	void lockstep_runner::reindex() {
+		for (std::size_t g = 0; g < m_groups.size(); g++) {
+			for (auto lane : m_groups[g].lanes) {
+				m_group_of[lane] = g;
+			}
+		}
+	}
+
+}
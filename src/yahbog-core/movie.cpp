@@ -0,0 +1,335 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <yahbog/movie.h>
+#include <yahbog/utility/varint.h>
+
+namespace yahbog {
+
+	namespace {
+		struct movie_file_header {
+			constexpr static std::uint32_t expected_magic = 0x4D424859; // "YHBM"
+			constexpr static std::uint32_t current_version = 1;
+
+			std::uint32_t magic = expected_magic;
+			std::uint32_t version = current_version;
+			std::uint64_t rom_hash = 0;
+			std::uint64_t frames = 0;
+			std::uint64_t keyframes = 0;
+			std::uint64_t events_size = 0;
+			std::uint64_t states_size = 0;
+		};
+
+		template<typename T>
+		void read_exact(std::ifstream& in, T* data, std::size_t count, const std::filesystem::path& path) {
+			if (!in.read(reinterpret_cast<char*>(data), count * sizeof(T))) {
+				throw std::invalid_argument(std::format("Movie {} is truncated", path.string()));
+			}
+		}
+
+		// Walks the events, checking that every one is complete, and returns the
+		// number of frame ends
+		std::uint64_t count_frames(std::span<const std::byte> events) {
+			const std::byte* p = events.data();
+			const std::byte* end = p + events.size();
+
+			std::uint64_t frames = 0;
+			std::uint64_t code = 0;
+			while (p < end) {
+				if (!get_varint(p, end, code)) {
+					throw std::invalid_argument(std::format("Movie event at {} is truncated", p - events.data()));
+				}
+				if (code & 1) {
+					frames++;
+				}
+				else if (p++ == end) {
+					throw std::invalid_argument("Movie ends inside an input event");
+				}
+			}
+			return frames;
+		}
+	}
+
+	void movie::save(const std::filesystem::path& path) const {
+		std::ofstream out(path, std::ios::binary);
+		if (!out.is_open()) {
+			throw std::runtime_error(std::format("Could not open {} to save a movie", path.string()));
+		}
+
+		const movie_file_header header{
+			.rom_hash = rom_hash,
+			.frames = frames,
+			.keyframes = index.size(),
+			.events_size = events.size(),
+			.states_size = states.size()
+		};
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(keyframe));
+		out.write(reinterpret_cast<const char*>(events.data()), events.size());
+		out.write(reinterpret_cast<const char*>(states.data()), states.size());
+
+		if (!out) {
+			throw std::runtime_error(std::format("Could not write movie to {}", path.string()));
+		}
+	}
+
+	movie movie::load(const std::filesystem::path& path) {
+		std::ifstream in(path, std::ios::binary);
+		if (!in.is_open()) {
+			throw std::runtime_error(std::format("Could not open movie {}", path.string()));
+		}
+
+		movie_file_header header{};
+		read_exact(in, &header, 1, path);
+
+		if (header.magic != movie_file_header::expected_magic) {
+			throw std::invalid_argument(std::format("{} is not a movie", path.string()));
+		}
+
+		if (header.version != movie_file_header::current_version) {
+			throw std::invalid_argument(std::format("Movie version {} is not supported (expected {})", header.version, movie_file_header::current_version));
+		}
+
+		// sizes are checked against the file before anything is allocated
+		const auto file_size = std::filesystem::file_size(path);
+		const auto body_size = file_size - sizeof(header);
+		if (header.keyframes == 0 || header.keyframes > body_size / sizeof(keyframe)
+			|| header.events_size > body_size || header.states_size > body_size
+			|| header.keyframes * sizeof(keyframe) + header.events_size + header.states_size != body_size) {
+			throw std::invalid_argument(std::format("Movie {} does not match the size in its header", path.string()));
+		}
+
+		movie m;
+		m.rom_hash = header.rom_hash;
+		m.frames = header.frames;
+		m.index.resize(header.keyframes);
+		m.events.resize(header.events_size);
+		m.states.resize(header.states_size);
+
+		read_exact(in, m.index.data(), m.index.size(), path);
+		read_exact(in, m.events.data(), m.events.size(), path);
+		read_exact(in, m.states.data(), m.states.size(), path);
+
+		if (count_frames(m.events) != m.frames) {
+			throw std::invalid_argument(std::format("Movie {} has a different number of frames than its header", path.string()));
+		}
+
+		for (std::size_t i = 0; i < m.index.size(); i++) {
+			const auto& key = m.index[i];
+			const bool ordered = i == 0 ? key.frame == 0 : key.frame > m.index[i - 1].frame;
+			if (!ordered || key.frame > m.frames || key.event_offset > m.events.size()
+				|| key.state_offset > m.states.size() || key.state_size > m.states.size() - key.state_offset) {
+				throw std::invalid_argument(std::format("Movie keyframe {} is out of range", i));
+			}
+		}
+
+		return m;
+	}
+
+	movie_recorder::movie_recorder(emulator& emu, std::size_t keyframe_interval)
+		: m_emu(emu), m_keyframe_interval(keyframe_interval), m_last_cycle(emu.z80.cycles()) {
+
+		if (keyframe_interval == 0) {
+			throw std::invalid_argument("Movie keyframe interval must not be zero");
+		}
+
+		m_movie.rom_hash = emu.rom.hash();
+		add_keyframe();
+	}
+
+	void movie_recorder::set_buttons(std::uint8_t pressed) {
+		if (pressed == m_emu.pad.buttons()) {
+			return;
+		}
+
+		const std::uint64_t now = m_emu.z80.cycles();
+		put_varint(m_movie.events, (now - m_last_cycle) << 1);
+		m_movie.events.push_back(static_cast<std::byte>(pressed));
+		m_last_cycle = now;
+
+		m_emu.set_buttons(pressed);
+	}
+
+	std::size_t movie_recorder::run_frame() {
+		const auto executed = m_emu.run_frame();
+
+		const std::uint64_t now = m_emu.z80.cycles();
+		put_varint(m_movie.events, ((now - m_last_cycle) << 1) | 1);
+		m_last_cycle = now;
+
+		if (++m_movie.frames % m_keyframe_interval == 0) {
+			add_keyframe();
+		}
+		return executed;
+	}
+
+	movie movie_recorder::finish() {
+		if (m_movie.index.back().frame != m_movie.frames) {
+			add_keyframe();
+		}
+		return std::move(m_movie);
+	}
+
+	void movie_recorder::add_keyframe() {
+		const auto offset = m_movie.states.size();
+		m_movie.states.resize(offset + m_emu.state_size());
+		const auto size = m_emu.save_state({ m_movie.states.data() + offset, m_movie.states.size() - offset });
+
+		m_movie.index.push_back({ m_movie.frames, m_last_cycle, m_movie.events.size(), offset, size });
+	}
+
+	namespace {
+		std::span<const std::byte> keyframe_state(const movie& m, const movie::keyframe& key) {
+			return { m.states.data() + key.state_offset, key.state_size };
+		}
+	}
+
+	std::vector<movie_divergence> verify_movie(const movie& m, const emulator& prototype, std::size_t threads) {
+		if (m.index.size() < 2) {
+			return {};
+		}
+
+		const auto segments = m.index.size() - 1;
+		if (threads == 0) {
+			threads = (std::max)(1u, std::thread::hardware_concurrency());
+		}
+		threads = (std::min)(threads, segments);
+
+		std::vector<movie_divergence> divergences;
+		std::exception_ptr error;
+		std::mutex results;
+		std::atomic<std::size_t> next = 0;
+
+		auto verify_segments = [&]() {
+			try {
+				auto emu = prototype.clone();
+				movie_player player(m, *emu);
+				// keyframes are loaded into a second emulator to hash them the same way
+				auto reference = prototype.clone();
+
+				for (auto i = next++; i < segments; i = next++) {
+					const auto& from = m.index[i];
+					const auto& to = m.index[i + 1];
+
+					player.load_keyframe(i);
+					while (player.frame() < to.frame && player.run_frame()) {}
+
+					reference->load_state(keyframe_state(m, to));
+					const auto expected = reference->state_hash();
+					const auto actual = emu->state_hash();
+					if (expected != actual) {
+						std::scoped_lock lock(results);
+						divergences.push_back({ i, from.frame, to.frame, expected, actual });
+					}
+				}
+			}
+			catch (...) {
+				std::scoped_lock lock(results);
+				if (!error) {
+					error = std::current_exception();
+				}
+				// stop the other threads early
+				next = segments;
+			}
+		};
+
+		{
+			std::vector<std::jthread> pool;
+			for (std::size_t t = 1; t < threads; t++) {
+				pool.emplace_back(verify_segments);
+			}
+			verify_segments();
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		std::ranges::sort(divergences, {}, &movie_divergence::segment);
+		return divergences;
+	}
+
+	movie_player::movie_player(const movie& m, emulator& emu) : m_movie(m), m_emu(emu) {
+		if (m.rom_hash != emu.rom.hash()) {
+			throw std::invalid_argument(std::format("Movie was recorded with ROM {:016X}, but {:016X} is loaded", m.rom_hash, emu.rom.hash()));
+		}
+		if (m.index.empty()) {
+			throw std::invalid_argument("Movie has no starting state");
+		}
+
+		restore(m.index.front());
+	}
+
+	bool movie_player::run_frame() {
+		const auto& events = m_movie.events;
+		const std::byte* begin = events.data();
+		const std::byte* end = begin + events.size();
+
+		while (m_pos < events.size()) {
+			const std::byte* p = begin + m_pos;
+			std::uint64_t code = 0;
+			if (!get_varint(p, end, code)) {
+				throw std::invalid_argument(std::format("Movie event at {} is truncated", m_pos));
+			}
+
+			const auto target = m_cycle + (code >> 1);
+			while (m_emu.z80.cycles() < target) {
+				m_emu.tick();
+			}
+			m_cycle = target;
+
+			if (code & 1) {
+				m_pos = p - begin;
+				m_frame++;
+				return true;
+			}
+
+			if (p == end) {
+				throw std::invalid_argument("Movie ends inside an input event");
+			}
+			m_emu.set_buttons(std::to_integer<std::uint8_t>(*p++));
+			m_pos = p - begin;
+		}
+
+		return false;
+	}
+
+	void movie_player::seek(std::uint64_t frame) {
+		if (frame > m_movie.frames) {
+			throw std::out_of_range(std::format("Cannot seek to frame {} of a {} frame movie", frame, m_movie.frames));
+		}
+
+		const auto key = std::prev(std::upper_bound(m_movie.index.begin(), m_movie.index.end(), frame,
+			[](std::uint64_t f, const movie::keyframe& k) { return f < k.frame; }));
+
+		// replaying on is cheaper unless the target is behind or past another keyframe
+		if (frame < m_frame || key->frame > m_frame) {
+			restore(*key);
+		}
+
+		while (m_frame < frame && run_frame()) {}
+	}
+
+	void movie_player::load_keyframe(std::size_t index) {
+		if (index >= m_movie.index.size()) {
+			throw std::out_of_range(std::format("Movie has no keyframe {}", index));
+		}
+		restore(m_movie.index[index]);
+	}
+
+	void movie_player::restore(const movie::keyframe& key) {
+		m_emu.load_state(keyframe_state(m_movie, key));
+		m_frame = key.frame;
+		m_cycle = key.cycle;
+		m_pos = key.event_offset;
+	}
+
+}
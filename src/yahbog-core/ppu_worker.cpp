@@ -0,0 +1,99 @@
+#include <yahbog/ppu_worker.h>
+
+namespace yahbog {
+
+	ppu_worker::ppu_worker(gpu& source) : m_source(source), m_shadow(std::make_unique<gpu>(source)) {
+		m_shadow->read_fn = nullptr;
+		m_shadow->write_fn = nullptr;
+		m_shadow->m_deferred = nullptr;
+		m_shadow->m_log.clear();
+
+		m_front = source.m_framebuffer;
+		m_pending.reserve(gpu::max_log_entries);
+
+		m_thread = std::jthread([this](std::stop_token stop) { run(stop); });
+		m_source.defer_rendering(this);
+	}
+
+	ppu_worker::~ppu_worker() {
+		// draw the lines of the frame in progress too, so that inline rendering
+		// carries on from the same framebuffer
+		submit(m_source.m_log, false);
+		sync();
+		m_source.m_framebuffer = m_shadow->m_framebuffer;
+		m_source.m_line_hasher = m_shadow->m_line_hasher;
+		m_source.defer_rendering(nullptr);
+
+		m_thread.request_stop();
+		m_work_cv.notify_all();
+	}
+
+	void ppu_worker::submit(std::vector<ppu_log_entry>& log, bool frame_complete) {
+		std::unique_lock lock(m_mutex);
+
+		// at most one frame is in flight; the CPU thread only waits here when
+		// rasterizing took longer than emulating a whole frame
+		m_idle_cv.wait(lock, [this] { return !m_busy; });
+
+		m_pending.swap(log);
+		m_pending_frame = frame_complete;
+		m_busy = true;
+
+		lock.unlock();
+		m_work_cv.notify_one();
+	}
+
+	void ppu_worker::sync() {
+		std::unique_lock lock(m_mutex);
+		m_idle_cv.wait(lock, [this] { return !m_busy; });
+
+		m_source.m_frame_hash = m_shadow->m_frame_hash;
+		if (m_shadow->has_output()) {
+			// the shadow draws into the registered output directly
+			m_source.m_back = m_shadow->m_back;
+		}
+		else {
+			m_source.m_framebuffer = m_front;
+		}
+	}
+
+	std::size_t ppu_worker::latest(gpu::framebuffer_t& out) const {
+		std::scoped_lock lock(m_mutex);
+		out = m_front;
+		return m_rendered;
+	}
+
+	std::size_t ppu_worker::frames_rendered() const {
+		std::scoped_lock lock(m_mutex);
+		return m_rendered;
+	}
+
+	void ppu_worker::run(std::stop_token stop) {
+		while (true) {
+			{
+				std::unique_lock lock(m_mutex);
+				if (!m_work_cv.wait(lock, stop, [this] { return m_busy; })) {
+					return;
+				}
+			}
+
+			for (const auto& entry : m_pending) {
+				m_shadow->replay(entry);
+			}
+			m_pending.clear();
+
+			{
+				std::scoped_lock lock(m_mutex);
+				if (m_pending_frame) {
+					if (!m_shadow->has_output()) {
+						m_front = m_shadow->m_framebuffer;
+					}
+					m_rendered++;
+				}
+				m_busy = false;
+			}
+			m_idle_cv.notify_all();
+		}
+	}
+
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include <yahbog/ram_gather.h>
+
+namespace yahbog {
+
+	ram_gather::ram_gather(std::span<const ram_range> ranges) {
+		for (const auto& range : ranges) {
+			if (range.start + std::size_t{ range.length } > 0x10000) {
+				throw std::invalid_argument(std::format("RAM range {:04X}+{} leaves the address space", range.start, range.length));
+			}
+
+			std::size_t done = 0;
+			while (done < range.length) {
+				const auto addr = static_cast<std::uint16_t>(range.start + done);
+				const auto run = emulator::memory_run_at(addr);
+				const auto count = static_cast<std::uint16_t>((std::min<std::size_t>)(run.length, range.length - done));
+
+				// registers come one byte at a time, but a row of them is one segment
+				if (!m_segments.empty()) {
+					auto& last = m_segments.back();
+					const bool contiguous = run.region == emulator::memory_region::bus
+						|| run.region == emulator::memory_region::open_bus || last.offset + last.length == run.offset;
+					if (last.region == run.region && last.address + last.length == addr && contiguous) {
+						last.length += count;
+						done += count;
+						continue;
+					}
+				}
+
+				m_segments.push_back({ run.region, addr, run.offset, count, static_cast<std::uint32_t>(m_size + done) });
+				done += count;
+			}
+			m_size += range.length;
+		}
+	}
+
+	void ram_gather::gather(emulator& emu, std::span<std::uint8_t> out) const {
+		if (out.size() != m_size) {
+			throw std::invalid_argument(std::format("Expected {} bytes to gather into, got {}", m_size, out.size()));
+		}
+
+		for (const auto& s : m_segments) {
+			const auto storage = emu.region_storage(s.region);
+			if (s.region == emulator::memory_region::open_bus) {
+				std::memset(out.data() + s.out, 0xFF, s.length);
+			}
+			else if (s.offset + std::size_t{ s.length } <= storage.size()) {
+				std::memcpy(out.data() + s.out, storage.data() + s.offset, s.length);
+			}
+			else {
+				// registers, and external RAM while it is disabled
+				emu.peek_span(s.address, out.subspan(s.out, s.length));
+			}
+		}
+	}
+
+}
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+
+#include <yahbog/resampler.h>
+
+namespace yahbog {
+
+	namespace {
+		constexpr std::size_t taps = resampler::taps;
+		constexpr int coefficient_bits = resampler::coefficient_bits;
+
+		// Products of Q14 coefficients and 16-bit samples; a phase's absolute
+		// coefficients sum to at most about 2, so the sums stay well inside 32 bits
+		void filter_scalar(const std::int16_t* kernel, const std::int16_t* left, const std::int16_t* right, std::int32_t* out) {
+			std::int32_t sum_left = 0;
+			std::int32_t sum_right = 0;
+			for (std::size_t i = 0; i < taps; i++) {
+				sum_left += kernel[i] * left[i];
+				sum_right += kernel[i] * right[i];
+			}
+			out[0] = sum_left;
+			out[1] = sum_right;
+		}
+
+#if defined(YAHBOG_X86)
+		YAHBOG_TARGET("sse2") std::int32_t horizontal_sum(__m128i v) {
+			v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+			v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_cvtsi128_si32(v);
+		}
+
+		YAHBOG_TARGET("sse2") void filter_sse2(const std::int16_t* kernel, const std::int16_t* left, const std::int16_t* right, std::int32_t* out) {
+			__m128i sum_left = _mm_setzero_si128();
+			__m128i sum_right = _mm_setzero_si128();
+			for (std::size_t i = 0; i < taps; i += 8) {
+				const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kernel + i));
+				sum_left = _mm_add_epi32(sum_left, _mm_madd_epi16(k, _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i))));
+				sum_right = _mm_add_epi32(sum_right, _mm_madd_epi16(k, _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i))));
+			}
+			out[0] = horizontal_sum(sum_left);
+			out[1] = horizontal_sum(sum_right);
+		}
+
+		YAHBOG_TARGET("avx2") void filter_avx2(const std::int16_t* kernel, const std::int16_t* left, const std::int16_t* right, std::int32_t* out) {
+			__m256i sum_left = _mm256_setzero_si256();
+			__m256i sum_right = _mm256_setzero_si256();
+			for (std::size_t i = 0; i < taps; i += 16) {
+				const __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kernel + i));
+				sum_left = _mm256_add_epi32(sum_left, _mm256_madd_epi16(k, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i))));
+				sum_right = _mm256_add_epi32(sum_right, _mm256_madd_epi16(k, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i))));
+			}
+			out[0] = horizontal_sum(_mm_add_epi32(_mm256_castsi256_si128(sum_left), _mm256_extracti128_si256(sum_left, 1)));
+			out[1] = horizontal_sum(_mm_add_epi32(_mm256_castsi256_si128(sum_right), _mm256_extracti128_si256(sum_right, 1)));
+		}
+#endif
+
+		std::int16_t to_sample(std::int32_t v, std::int16_t*) {
+			const std::int32_t rounded = (v + (1 << (coefficient_bits - 1))) >> coefficient_bits;
+			return static_cast<std::int16_t>(std::clamp(rounded, -32768, 32767));
+		}
+
+		float to_sample(std::int32_t v, float*) {
+			return static_cast<float>(v) * (1.0f / (32768.0f * (1 << coefficient_bits)));
+		}
+	}
+
+	static_assert(resampler::taps % 16 == 0, "SIMD kernels consume sixteen taps at a time");
+
+	resampler::resampler(std::uint32_t output_rate, std::uint32_t input_rate, simd::level level)
+		: m_output_rate(output_rate), m_input_rate(input_rate), m_level((std::min)(level, simd::best())) {
+
+		if (output_rate == 0 || input_rate == 0) {
+			throw std::invalid_argument(std::format("Invalid resampling rates {} -> {}", input_rate, output_rate));
+		}
+
+		m_step = (static_cast<std::uint64_t>(input_rate) << frac_bits) / output_rate;
+
+		switch (m_level) {
+#if defined(YAHBOG_X86)
+		case simd::level::avx2: m_filter = filter_avx2; break;
+		case simd::level::sse2: m_filter = filter_sse2; break;
+#endif
+		default: m_filter = filter_scalar; break;
+		}
+
+		// cutoff a little below the lower Nyquist frequency, in cycles per input sample
+		const double cutoff = 0.5 * 0.92 * (std::min)(1.0, static_cast<double>(output_rate) / input_rate);
+		const double pi = 3.14159265358979323846;
+
+		m_kernels.resize(phases);
+		for (std::size_t p = 0; p < phases; p++) {
+			const double frac = static_cast<double>(p) / phases;
+
+			std::array<double, taps> h{};
+			double total = 0.0;
+			for (std::size_t i = 0; i < taps; i++) {
+				const double x = static_cast<double>(i) - (taps / 2 - 1) - frac;
+				const double u = (x + taps / 2.0) / taps;
+				const double window = 0.42 - 0.5 * std::cos(2 * pi * u) + 0.08 * std::cos(4 * pi * u);
+				const double sinc = x == 0.0 ? 1.0 : std::sin(2 * pi * cutoff * x) / (2 * pi * cutoff * x);
+
+				h[i] = sinc * window;
+				total += h[i];
+			}
+
+			// unity gain at DC for every phase, exactly: the rounding error goes to
+			// the tap nearest the centre
+			std::int32_t quantized = 0;
+			for (std::size_t i = 0; i < taps; i++) {
+				m_kernels[p][i] = static_cast<std::int16_t>(std::lrint(h[i] / total * (1 << coefficient_bits)));
+				quantized += m_kernels[p][i];
+			}
+			m_kernels[p][frac < 0.5 ? taps / 2 - 1 : taps / 2] += static_cast<std::int16_t>((1 << coefficient_bits) - quantized);
+		}
+	}
+
+	void resampler::push(std::span<const std::int16_t> frames) {
+		const auto count = frames.size() / 2;
+		m_left.reserve(m_left.size() + count);
+		m_right.reserve(m_right.size() + count);
+
+		for (std::size_t i = 0; i < count; i++) {
+			m_left.push_back(frames[i * 2]);
+			m_right.push_back(frames[i * 2 + 1]);
+		}
+	}
+
+	void resampler::push(apu& source) {
+		m_scratch.resize(source.samples_available() * 2);
+		const auto frames = source.read_samples(m_scratch);
+		push(std::span<const std::int16_t>(m_scratch.data(), frames * 2));
+	}
+
+	std::size_t resampler::frames_available() const noexcept {
+		if (m_left.size() < taps) {
+			return 0;
+		}
+
+		// the last input index a whole kernel fits after
+		const std::uint64_t last = static_cast<std::uint64_t>(m_left.size() - taps) << frac_bits;
+		if (m_position > last) {
+			return 0;
+		}
+		return static_cast<std::size_t>((last - m_position) / m_step + 1);
+	}
+
+	std::size_t resampler::pull(std::span<std::int16_t> out) {
+		return pull_frames(out);
+	}
+
+	std::size_t resampler::pull(std::span<float> out) {
+		return pull_frames(out);
+	}
+
+	void resampler::clear() noexcept {
+		m_left.clear();
+		m_right.clear();
+		m_position = 0;
+	}
+
+	template<typename T>
+	std::size_t resampler::pull_frames(std::span<T> out) {
+		const auto frames = (std::min)(frames_available(), out.size() / 2);
+
+		for (std::size_t f = 0; f < frames; f++) {
+			const auto index = static_cast<std::size_t>(m_position >> frac_bits);
+			const auto phase = static_cast<std::size_t>((m_position & 0xFFFFFFFFull) >> (frac_bits - phase_bits));
+
+			std::int32_t mixed[2];
+			m_filter(m_kernels[phase].data(), m_left.data() + index, m_right.data() + index, mixed);
+
+			out[f * 2] = to_sample(mixed[0], static_cast<T*>(nullptr));
+			out[f * 2 + 1] = to_sample(mixed[1], static_cast<T*>(nullptr));
+			m_position += m_step;
+		}
+
+		// drop input that no future output frame reaches
+		const auto consumed = (std::min)(static_cast<std::size_t>(m_position >> frac_bits), m_left.size());
+		m_left.erase(m_left.begin(), m_left.begin() + consumed);
+		m_right.erase(m_right.begin(), m_right.begin() + consumed);
+		m_position -= static_cast<std::uint64_t>(consumed) << frac_bits;
+
+		return frames;
+	}
+
+}
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#include <yahbog/rewind.h>
+#include <yahbog/utility/varint.h>
+
+namespace yahbog {
+
+	namespace {
+		bool zero_word(const std::byte* p) {
+			std::uint64_t word;
+			std::memcpy(&word, p, sizeof(word));
+			return word == 0;
+		}
+
+		void xor_words(std::span<const std::byte> a, std::span<const std::byte> b, std::span<std::byte> out) {
+			std::size_t i = 0;
+			for (; i + 8 <= out.size(); i += 8) {
+				std::uint64_t x, y;
+				std::memcpy(&x, a.data() + i, sizeof(x));
+				std::memcpy(&y, b.data() + i, sizeof(y));
+				x ^= y;
+				std::memcpy(out.data() + i, &x, sizeof(x));
+			}
+			for (; i < out.size(); i++) {
+				out[i] = a[i] ^ b[i];
+			}
+		}
+
+		// Run-length encodes data as records of (zero run, literal length, literal
+		// bytes). Scanning goes a word at a time: a literal ends at the next all-zero
+		// word, so it may carry a few zero bytes, but no byte is inspected twice.
+		void encode(std::span<const std::byte> data, std::vector<std::byte>& out) {
+			const auto n = data.size();
+
+			out.clear();
+			std::size_t i = 0;
+			while (i < n) {
+				const auto run_start = i;
+				while (i + 8 <= n && zero_word(data.data() + i)) {
+					i += 8;
+				}
+				while (i < n && data[i] == std::byte{ 0 }) {
+					i++;
+				}
+				if (i == n) {
+					break;
+				}
+
+				const auto literal_start = i;
+				while (i + 8 <= n && !zero_word(data.data() + i)) {
+					i += 8;
+				}
+				if (i + 8 > n) {
+					i = n;
+				}
+
+				put_varint(out, literal_start - run_start);
+				put_varint(out, i - literal_start);
+				out.insert(out.end(), data.begin() + literal_start, data.begin() + i);
+			}
+		}
+
+		// XORs encoded literals into target: rebuilds a keyframe over zeros, and
+		// applies or undoes a delta over its neighbouring state
+		void apply(std::span<const std::byte> encoded, std::span<std::byte> target) {
+			const std::byte* p = encoded.data();
+			const std::byte* end = p + encoded.size();
+
+			std::size_t pos = 0;
+			std::uint64_t skip = 0, length = 0;
+			while (get_varint(p, end, skip) && get_varint(p, end, length)) {
+				pos += skip;
+				for (std::size_t i = 0; i < length; i++) {
+					target[pos + i] ^= p[i];
+				}
+				p += length;
+				pos += length;
+			}
+		}
+	}
+
+	rewind_buffer::rewind_buffer(std::size_t budget_bytes, std::size_t keyframe_interval) : m_keyframe_interval(keyframe_interval) {
+		if (budget_bytes == 0 || keyframe_interval == 0) {
+			throw std::invalid_argument(std::format("Invalid rewind budget {} or keyframe interval {}", budget_bytes, keyframe_interval));
+		}
+		m_storage.resize(budget_bytes);
+	}
+
+	bool rewind_buffer::push(emulator& emu) {
+		m_current.resize(emu.state_size());
+		emu.save_state(m_current);
+
+		bool keyframe = m_entries.empty()
+			|| m_since_keyframe + 1 >= m_keyframe_interval
+			|| m_newest.size() != m_current.size();
+
+		if (keyframe) {
+			encode(m_current, m_encoded);
+		}
+		else {
+			m_delta.resize(m_current.size());
+			xor_words(m_current, m_newest, m_delta);
+			encode(m_delta, m_encoded);
+		}
+
+		std::size_t offset = 0;
+		if (!allocate(m_encoded.size(), offset)) {
+			return false;
+		}
+
+		// making room evicted the group this delta builds on
+		if (!keyframe && m_entries.empty()) {
+			keyframe = true;
+			encode(m_current, m_encoded);
+			if (!allocate(m_encoded.size(), offset)) {
+				return false;
+			}
+		}
+
+		std::copy(m_encoded.begin(), m_encoded.end(), m_storage.begin() + offset);
+		m_entries.push_back({ offset, m_encoded.size(), m_current.size(), keyframe });
+
+		m_newest.swap(m_current);
+		m_since_keyframe = keyframe ? 0 : m_since_keyframe + 1;
+		return true;
+	}
+
+	bool rewind_buffer::rewind(emulator& emu) {
+		if (m_entries.empty()) {
+			return false;
+		}
+
+		emu.load_state(m_newest);
+
+		const auto last = m_entries.back();
+		m_entries.pop_back();
+
+		if (m_entries.empty()) {
+			m_newest.clear();
+			m_since_keyframe = 0;
+		}
+		else if (!last.keyframe) {
+			// XOR is its own inverse, so the delta also steps back
+			apply({ m_storage.data() + last.offset, last.length }, m_newest);
+			m_since_keyframe--;
+		}
+		else {
+			reconstruct_newest();
+		}
+
+		return true;
+	}
+
+	std::size_t rewind_buffer::bytes_used() const noexcept {
+		std::size_t total = 0;
+		for (const auto& e : m_entries) {
+			total += e.length;
+		}
+		return total;
+	}
+
+	void rewind_buffer::clear() noexcept {
+		m_entries.clear();
+		m_newest.clear();
+		m_since_keyframe = 0;
+	}
+
+	bool rewind_buffer::allocate(std::size_t length, std::size_t& offset) {
+		if (length > m_storage.size()) {
+			return false;
+		}
+
+		std::size_t pos = m_entries.empty() ? 0 : m_entries.back().offset + m_entries.back().length;
+		if (pos + length > m_storage.size()) {
+			// entries stored past the newest one are older than those before it, and
+			// the record does not fit after them, so they go before wrapping around
+			while (!m_entries.empty() && m_entries.front().offset > m_entries.back().offset) {
+				evict_oldest_group();
+			}
+			pos = 0;
+		}
+
+		// entries sit in age order after the free gap, so only the oldest can be in the way
+		while (!m_entries.empty()) {
+			const auto& oldest = m_entries.front();
+			if (oldest.offset >= pos + length || oldest.offset + oldest.length <= pos) {
+				break;
+			}
+			evict_oldest_group();
+		}
+
+		offset = pos;
+		return true;
+	}
+
+	void rewind_buffer::evict_oldest_group() {
+		m_entries.pop_front();
+		while (!m_entries.empty() && !m_entries.front().keyframe) {
+			m_entries.pop_front();
+		}
+	}
+
+	void rewind_buffer::reconstruct_newest() {
+		auto key = m_entries.size() - 1;
+		while (!m_entries[key].keyframe) {
+			key--;
+		}
+
+		m_newest.assign(m_entries[key].state_size, std::byte{ 0 });
+		for (auto i = key; i < m_entries.size(); i++) {
+			apply({ m_storage.data() + m_entries[i].offset, m_entries[i].length }, m_newest);
+		}
+		m_since_keyframe = m_entries.size() - 1 - key;
+	}
+
+}
@@ -12,4 +12,33 @@ namespace yahbog {
 		std::vector<std::uint8_t> data(std::istreambuf_iterator<char>(file), {});
 		return load_rom(std::move(data));
 	}
+
+	bool rom_t::load_rom(std::vector<std::uint8_t>&& data) {
+		if(data.size() < 0x8000) {
+			return false;
+		}
+
+		return load_rom(std::make_shared<const std::vector<std::uint8_t>>(std::move(data)));
+	}
+
+	bool rom_t::load_rom(std::shared_ptr<const std::vector<std::uint8_t>> image) {
+		if(!image || image->size() < 0x8000) {
+			return false;
+		}
+		
+		rom_image = std::move(image);
+		rom_data = *rom_image;
+		rom_hash = xxhash64_of(rom_data);
+		header_ = rom_header_t::from_bytes({rom_image->data() + 0x0100, sizeof(rom_header_t)});
+
+		auto ram_size = detail::calc_ram_size(header_.ram_size);
+		if(ram_size > 0) {
+			ext_ram.resize(ram_size);
+		}
+
+		rom_bank = 1;
+		ram_bank = (std::numeric_limits<std::size_t>::max)();
+
+		return true;
+	}
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <yahbog/thread_pool.h>
+
+namespace yahbog {
+
+	namespace {
+		// Best effort: pinning is a placement hint, so failure is not an error
+		void pin_to_core(std::size_t core) {
+			const auto cores = (std::max)(1u, std::thread::hardware_concurrency());
+			core %= cores;
+#if defined(_WIN32)
+			if (core < sizeof(DWORD_PTR) * 8) {
+				SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+			}
+#elif defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(core, &set);
+			pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+			(void)core;
+#endif
+		}
+	}
+
+	thread_pool::thread_pool(std::size_t threads, bool pin_threads) {
+		if (threads == 0) {
+			threads = (std::max)(1u, std::thread::hardware_concurrency());
+		}
+
+		for (std::size_t i = 0; i < threads; i++) {
+			m_queues.push_back(std::make_unique<queue>());
+		}
+
+		// the calling thread belongs to the caller, so only workers are pinned,
+		// leaving core 0 to it
+		for (std::size_t slot = 1; slot < threads; slot++) {
+			m_threads.emplace_back([this, slot, pin_threads](std::stop_token stop) {
+				if (pin_threads) {
+					pin_to_core(slot);
+				}
+				worker(slot, stop);
+			});
+		}
+	}
+
+	thread_pool::~thread_pool() {
+		for (auto& t : m_threads) {
+			t.request_stop();
+		}
+		m_wake.notify_all();
+	}
+
+	void thread_pool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& task) {
+		if (count == 0) {
+			return;
+		}
+
+		m_task = &task;
+		m_error = nullptr;
+		m_remaining = count;
+
+		const auto slots = m_queues.size();
+		for (std::size_t slot = 0; slot < slots; slot++) {
+			std::scoped_lock lock(m_queues[slot]->lock);
+			m_queues[slot]->begin = count * slot / slots;
+			m_queues[slot]->end = count * (slot + 1) / slots;
+		}
+
+		{
+			std::scoped_lock lock(m_wake_lock);
+			m_generation++;
+		}
+		m_wake.notify_all();
+
+		drain(0);
+
+		// the last tasks may still be running on workers that stole them
+		for (auto left = m_remaining.load(); left != 0; left = m_remaining.load()) {
+			m_remaining.wait(left);
+		}
+
+		m_task = nullptr;
+		if (m_error) {
+			std::rethrow_exception(std::exchange(m_error, nullptr));
+		}
+	}
+
+	void thread_pool::worker(std::size_t slot, std::stop_token stop) {
+		std::uint64_t seen = 0;
+		while (true) {
+			{
+				std::unique_lock lock(m_wake_lock);
+				if (!m_wake.wait(lock, stop, [&] { return m_generation != seen; })) {
+					return;
+				}
+				seen = m_generation;
+			}
+			drain(slot);
+		}
+	}
+
+	void thread_pool::drain(std::size_t slot) {
+		std::size_t index = 0;
+		while (pop(slot, index) || steal(slot, index)) {
+			try {
+				(*m_task)(index);
+			}
+			catch (...) {
+				std::scoped_lock lock(m_error_lock);
+				if (!m_error) {
+					m_error = std::current_exception();
+				}
+			}
+
+			if (--m_remaining == 0) {
+				m_remaining.notify_all();
+			}
+		}
+	}
+
+	bool thread_pool::pop(std::size_t slot, std::size_t& index) {
+		auto& q = *m_queues[slot];
+		std::scoped_lock lock(q.lock);
+		if (q.begin == q.end) {
+			return false;
+		}
+		index = q.begin++;
+		return true;
+	}
+
+	bool thread_pool::steal(std::size_t thief, std::size_t& index) {
+		const auto slots = m_queues.size();
+		for (std::size_t n = 1; n < slots; n++) {
+			auto& q = *m_queues[(thief + n) % slots];
+			std::scoped_lock lock(q.lock);
+			if (q.begin != q.end) {
+				index = --q.end;
+				return true;
+			}
+		}
+		return false;
+	}
+
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+#include <yahbog/vector_env.h>
+
+namespace yahbog {
+
+	vector_env::vector_env(const emulator& prototype, vector_env_options options)
+		: m_options(std::move(options)), m_gather(m_options.ram), m_pool(m_options.threads, m_options.pin_threads) {
+
+		if (m_options.envs == 0) {
+			throw std::invalid_argument("A vector_env needs at least one env");
+		}
+
+		m_observation_size = (m_options.frame ? gpu::framebuffer_size : 0) + m_gather.size();
+
+		m_envs.resize(m_options.envs);
+		for (auto& e : m_envs) {
+			e.emu = prototype.clone();
+			// observations carry no audio, so only keep the sound registers behaving
+			e.emu->spu.set_synthesis(false);
+		}
+
+		auto& first = *m_envs.front().emu;
+		m_start.resize(first.state_size());
+		m_start.resize(first.save_state(m_start));
+
+		m_reset_task = [this](std::size_t i) {
+			if (m_mask.empty() || m_mask[i]) {
+				restart(i);
+				observe(i);
+			}
+		};
+
+		m_step_task = [this](std::size_t i) {
+			auto& e = m_envs[i];
+			e.emu->set_buttons(m_actions[i]);
+			e.emu->run_frame();
+			e.steps++;
+			observe(i);
+
+			const auto obs = observation(i);
+			m_rewards[i] = m_options.reward ? m_options.reward(i, *e.emu, obs) : 0.0f;
+
+			const bool done = (m_options.done && m_options.done(i, *e.emu, obs))
+				|| (m_options.max_episode_steps != 0 && e.steps >= m_options.max_episode_steps);
+			m_dones[i] = done;
+
+			if (done) {
+				restart(i);
+				observe(i);
+			}
+		};
+	}
+
+	void vector_env::reset(std::span<const std::uint8_t> mask, std::span<std::uint8_t> observations) {
+		if (!mask.empty()) {
+			check_per_env(mask.size(), "mask bytes");
+		}
+		check_observations(observations);
+
+		m_mask = mask;
+		m_observations = observations;
+		m_pool.parallel_for(m_envs.size(), m_reset_task);
+	}
+
+	void vector_env::step(std::span<const std::uint8_t> actions, std::span<std::uint8_t> observations,
+		std::span<float> rewards, std::span<std::uint8_t> dones) {
+
+		check_per_env(actions.size(), "actions");
+		check_per_env(rewards.size(), "rewards");
+		check_per_env(dones.size(), "done flags");
+		check_observations(observations);
+
+		m_actions = actions;
+		m_observations = observations;
+		m_rewards = rewards;
+		m_dones = dones;
+		m_pool.parallel_for(m_envs.size(), m_step_task);
+	}
+
+	void vector_env::check_per_env(std::size_t size, std::string_view what) const {
+		if (size != m_envs.size()) {
+			throw std::invalid_argument(std::format("Expected {} {}, one per env, got {}", m_envs.size(), what, size));
+		}
+	}
+
+	void vector_env::check_observations(std::span<const std::uint8_t> observations) const {
+		if (observations.size() != m_envs.size() * m_observation_size) {
+			throw std::invalid_argument(std::format("Expected {} observation bytes, got {}", m_envs.size() * m_observation_size, observations.size()));
+		}
+	}
+
+	void vector_env::restart(std::size_t i) {
+		m_envs[i].emu->load_state(m_start);
+		m_envs[i].steps = 0;
+	}
+
+	void vector_env::observe(std::size_t i) {
+		auto& emu = *m_envs[i].emu;
+		auto out = observation(i);
+
+		if (m_options.frame) {
+			std::ranges::copy(emu.ppu.framebuffer(), out.begin());
+			out = out.subspan(gpu::framebuffer_size);
+		}
+		m_gather.gather(emu, out);
+	}
+
+	std::span<std::uint8_t> vector_env::observation(std::size_t i) const {
+		return m_observations.subspan(i * m_observation_size, m_observation_size);
+	}
+
+}
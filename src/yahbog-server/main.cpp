@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <yahbog.h>
+
+#include "shm_protocol.h"
+
+namespace {
+
+	std::atomic<bool> stop_requested = false;
+
+	struct server_options {
+		std::string rom;
+		std::string name = "/yahbog";
+		std::size_t instances = 1;
+		std::size_t threads = 0;
+		double fps = 0;
+		std::vector<yahbog::ram_range> ram;
+	};
+
+	const char* usage =
+		"usage: yahbog-server <rom> [--name /NAME] [--instances N] [--threads N] [--fps N] [--ram START:LENGTH]...\n"
+		"  Runs N instances of the ROM and publishes their frames and RAM windows in the\n"
+		"  shared memory object NAME (default /yahbog). START is hexadecimal. Without\n"
+		"  --fps, frames run as fast as possible.\n";
+
+	template<typename T>
+	T parse_number(std::string_view text, int base = 10) {
+		T value{};
+		const auto [end, error] = [&] {
+			if constexpr (std::is_floating_point_v<T>) {
+				return std::from_chars(text.data(), text.data() + text.size(), value);
+			}
+			else {
+				return std::from_chars(text.data(), text.data() + text.size(), value, base);
+			}
+		}();
+		if (error != std::errc{} || end != text.data() + text.size()) {
+			throw std::invalid_argument(std::format("Invalid number '{}'", text));
+		}
+		return value;
+	}
+
+	server_options parse_options(int argc, char** argv) {
+		server_options options;
+		for (int i = 1; i < argc; i++) {
+			const std::string_view arg = argv[i];
+			auto value = [&]() -> std::string_view {
+				if (i + 1 >= argc) {
+					throw std::invalid_argument(std::format("{} needs a value", arg));
+				}
+				return argv[++i];
+			};
+
+			if (arg == "--name") {
+				options.name = value();
+			}
+			else if (arg == "--instances") {
+				options.instances = parse_number<std::size_t>(value());
+			}
+			else if (arg == "--threads") {
+				options.threads = parse_number<std::size_t>(value());
+			}
+			else if (arg == "--fps") {
+				options.fps = parse_number<double>(value());
+			}
+			else if (arg == "--ram") {
+				const auto range = value();
+				const auto colon = range.find(':');
+				if (colon == std::string_view::npos) {
+					throw std::invalid_argument(std::format("Expected START:LENGTH, got '{}'", range));
+				}
+				options.ram.push_back({ parse_number<std::uint16_t>(range.substr(0, colon), 16), parse_number<std::uint16_t>(range.substr(colon + 1)) });
+			}
+			else if (options.rom.empty() && !arg.starts_with("--")) {
+				options.rom = arg;
+			}
+			else {
+				throw std::invalid_argument(std::format("Unknown argument '{}'", arg));
+			}
+		}
+
+		if (options.rom.empty() || options.instances == 0) {
+			throw std::invalid_argument("A ROM and at least one instance are required");
+		}
+		if (!options.name.starts_with('/')) {
+			throw std::invalid_argument("The shared memory name must start with /");
+		}
+		if (options.ram.size() > yahbog::shm::max_ram_windows) {
+			throw std::invalid_argument(std::format("At most {} RAM windows are supported", yahbog::shm::max_ram_windows));
+		}
+		for (const auto& r : options.ram) {
+			if (r.start + std::size_t{ r.length } > 0x10000) {
+				throw std::invalid_argument(std::format("RAM window {:04X}+{} leaves the address space", r.start, r.length));
+			}
+		}
+		return options;
+	}
+
+	// Creates, maps and on destruction unlinks a POSIX shared memory object
+	class shared_memory {
+	public:
+		shared_memory(const std::string& name, std::size_t size) : m_name(name), m_size(size) {
+			m_fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+			if (m_fd < 0) {
+				throw std::system_error(errno, std::generic_category(), std::format("Could not create shared memory {}", name));
+			}
+
+			if (ftruncate(m_fd, static_cast<off_t>(size)) != 0) {
+				const auto error = errno;
+				release();
+				throw std::system_error(error, std::generic_category(), "Could not size shared memory");
+			}
+
+			m_data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+			if (m_data == MAP_FAILED) {
+				const auto error = errno;
+				m_data = nullptr;
+				release();
+				throw std::system_error(error, std::generic_category(), "Could not map shared memory");
+			}
+		}
+
+		~shared_memory() {
+			release();
+		}
+
+		shared_memory(const shared_memory&) = delete;
+		shared_memory& operator=(const shared_memory&) = delete;
+
+		std::byte* data() const noexcept { return static_cast<std::byte*>(m_data); }
+
+	private:
+		void release() {
+			if (m_data) {
+				munmap(m_data, m_size);
+			}
+			shm_unlink(m_name.c_str());
+			close(m_fd);
+		}
+
+		std::string m_name;
+		std::size_t m_size;
+		int m_fd = -1;
+		void* m_data = nullptr;
+	};
+
+	// Marks the server as shut down and wakes every client blocked on a slot,
+	// however serve() is left, so that no reader waits for a frame that will
+	// never be published
+	class shutdown_notice {
+	public:
+		shutdown_notice(yahbog::shm::server_header& header, const std::vector<yahbog::shm::instance_slot*>& slots)
+			: m_header(header), m_slots(slots) {}
+
+		~shutdown_notice() {
+			m_header.shutdown.store(1, std::memory_order_release);
+			for (auto slot : m_slots) {
+				yahbog::shm::wake_all(slot->sequence);
+			}
+		}
+
+		shutdown_notice(const shutdown_notice&) = delete;
+		shutdown_notice& operator=(const shutdown_notice&) = delete;
+
+	private:
+		yahbog::shm::server_header& m_header;
+		const std::vector<yahbog::shm::instance_slot*>& m_slots;
+	};
+
+	constexpr std::size_t align_up(std::size_t value, std::size_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// slots start on their own cache lines so instances do not share any
+	constexpr std::size_t cache_line = 64;
+
+	int serve(const server_options& options) {
+		auto prototype = std::make_unique<yahbog::emulator>();
+		if (!prototype->rom.load_rom(std::filesystem::path(options.rom))) {
+			throw std::runtime_error(std::format("Could not load ROM {}", options.rom));
+		}
+		prototype->reset();
+
+		const yahbog::ram_gather gather(options.ram);
+		const auto ram_size = static_cast<std::uint32_t>(gather.size());
+
+		const auto slots_offset = align_up(sizeof(yahbog::shm::server_header), cache_line);
+		const auto slot_stride = align_up(sizeof(yahbog::shm::instance_slot) + ram_size, cache_line);
+		shared_memory memory(options.name, slots_offset + slot_stride * options.instances);
+
+		auto& header = *new (memory.data()) yahbog::shm::server_header{
+			.magic = yahbog::shm::expected_magic,
+			.version = yahbog::shm::current_version,
+			.instances = static_cast<std::uint32_t>(options.instances),
+			.ram_window_count = static_cast<std::uint32_t>(options.ram.size()),
+			.ram_windows = {},
+			.ram_size = ram_size,
+			.slots_offset = slots_offset,
+			.slot_stride = slot_stride,
+			.shutdown = 0
+		};
+
+		std::uint32_t offset = 0;
+		for (std::size_t w = 0; w < options.ram.size(); w++) {
+			header.ram_windows[w] = { options.ram[w].start, options.ram[w].length, offset };
+			offset += options.ram[w].length;
+		}
+
+		std::vector<yahbog::shm::instance_slot*> slots;
+		shutdown_notice notice(header, slots);
+
+		std::vector<std::unique_ptr<yahbog::emulator>> instances;
+		for (std::size_t i = 0; i < options.instances; i++) {
+			slots.push_back(new (memory.data() + slots_offset + i * slot_stride) yahbog::shm::instance_slot{});
+			instances.push_back(prototype->clone());
+			// clients only see frames and RAM
+			instances.back()->spu.set_synthesis(false);
+		}
+
+		yahbog::thread_pool pool(options.threads);
+		const std::function<void(std::size_t)> run_instance = [&](std::size_t i) {
+			auto& emu = *instances[i];
+			auto& slot = *slots[i];
+
+			emu.set_buttons(static_cast<std::uint8_t>(slot.buttons.load(std::memory_order_relaxed)));
+			emu.run_frame();
+
+			yahbog::shm::begin_write(slot);
+			slot.frame++;
+			slot.frame_hash = emu.ppu.frame_hash();
+			std::ranges::copy(emu.ppu.framebuffer(), slot.framebuffer);
+
+			gather.gather(emu, { yahbog::shm::slot_ram(slot), ram_size });
+			yahbog::shm::end_write(slot);
+		};
+
+		std::cerr << std::format("Serving {} instance(s) of {} at {} ({} bytes)\n", options.instances, options.rom, options.name, slots_offset + slot_stride * options.instances);
+
+		using clock = std::chrono::steady_clock;
+		const auto period = options.fps > 0 ? std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / options.fps)) : clock::duration::zero();
+		auto next = clock::now();
+
+		while (!stop_requested.load(std::memory_order_relaxed)) {
+			pool.parallel_for(instances.size(), run_instance);
+
+			if (period != clock::duration::zero()) {
+				next += period;
+				std::this_thread::sleep_until(next);
+			}
+		}
+		return 0;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	server_options options;
+	try {
+		options = parse_options(argc, argv);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << "\n" << usage;
+		return 2;
+	}
+
+	struct sigaction action {};
+	action.sa_handler = [](int) { stop_requested.store(true, std::memory_order_relaxed); };
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+
+	try {
+		return serve(options);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+// Layout of the shared memory object that yahbog-server publishes, for
+// clients in other processes. Everything is in host byte order, and all
+// counters are lock-free 32-bit atomics, which are address-free, so they work
+// across processes.
+//
+// The object starts with a server_header, followed by one instance_slot per
+// instance, each slot_stride bytes apart from slots_offset. A slot's frame
+// and RAM windows are published under a seqlock: the server makes sequence
+// odd, writes, then makes it even again and wakes futex waiters on it.
+// Readers copy the data between two loads of sequence and retry if it was odd
+// or changed. Inputs go the other way: clients store buttons, which the
+// server reads before every frame.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <yahbog/ppu.h>
+
+#if defined(__linux__)
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+namespace yahbog::shm {
+
+	constexpr std::uint32_t expected_magic = 0x56534859; // "YHSV"
+	constexpr std::uint32_t current_version = 1;
+	constexpr std::size_t max_ram_windows = 16;
+
+	static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+	struct ram_window {
+		std::uint16_t start;
+		std::uint16_t length;
+		// offset of the window's bytes within instance_slot::ram
+		std::uint32_t offset;
+	};
+
+	struct server_header {
+		std::uint32_t magic;
+		std::uint32_t version;
+
+		std::uint32_t instances;
+		std::uint32_t ram_window_count;
+		ram_window ram_windows[max_ram_windows];
+		std::uint32_t ram_size;
+
+		std::uint64_t slots_offset;
+		std::uint64_t slot_stride;
+
+		// set when the server exits; the object is unlinked by then
+		std::atomic<std::uint32_t> shutdown;
+	};
+
+	struct instance_slot {
+		// written by clients: pressed buttons, a mask of button::*
+		std::atomic<std::uint32_t> buttons;
+
+		// seqlock over everything below
+		std::atomic<std::uint32_t> sequence;
+
+		std::uint64_t frame;
+		std::uint64_t frame_hash;
+		std::uint8_t framebuffer[gpu::framebuffer_size];
+
+		// followed by ram_size bytes of RAM windows, in the order of the header's
+	};
+
+	inline std::uint8_t* slot_ram(instance_slot& slot) {
+		return reinterpret_cast<std::uint8_t*>(&slot + 1);
+	}
+
+	inline const std::uint8_t* slot_ram(const instance_slot& slot) {
+		return reinterpret_cast<const std::uint8_t*>(&slot + 1);
+	}
+
+	inline void wake_all(std::atomic<std::uint32_t>& word) {
+#if defined(__linux__)
+		// not FUTEX_PRIVATE_FLAG: waiters are in other processes
+		syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+		(void)word;
+#endif
+	}
+
+	// Blocks while word still holds seen; may return early and spuriously
+	inline void wait(const std::atomic<std::uint32_t>& word, std::uint32_t seen) {
+#if defined(__linux__)
+		syscall(SYS_futex, reinterpret_cast<const std::uint32_t*>(&word), FUTEX_WAIT, seen, nullptr, nullptr, 0);
+#else
+		// std::atomic::wait is only specified within a process, so poll, giving
+		// up the core between tries once a short spin has not seen a change
+		for (int spins = 0; word.load(std::memory_order_acquire) == seen; spins++) {
+			if (spins >= 64) {
+				std::this_thread::yield();
+			}
+		}
+#endif
+	}
+
+	// Server side: brackets writes to a slot
+	inline void begin_write(instance_slot& slot) {
+		slot.sequence.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+	}
+
+	inline void end_write(instance_slot& slot) {
+		slot.sequence.fetch_add(1, std::memory_order_release);
+		wake_all(slot.sequence);
+	}
+
+	// Client side: copies a consistent frame, its hash and RAM snapshot, newer
+	// than the sequence last_seen (0 for any), waiting for the server if
+	// needed. Returns the sequence of the copy, to pass as last_seen next time,
+	// or 0 once the server has shut down.
+	inline std::uint32_t read_frame(const server_header& header, const instance_slot& slot, std::uint32_t last_seen,
+		std::uint8_t* framebuffer, std::uint8_t* ram, std::uint64_t& frame, std::uint64_t& frame_hash) {
+
+		while (!header.shutdown.load(std::memory_order_acquire)) {
+			const auto before = slot.sequence.load(std::memory_order_acquire);
+			if (before & 1 || before == last_seen) {
+				wait(slot.sequence, before);
+				continue;
+			}
+
+			frame = slot.frame;
+			frame_hash = slot.frame_hash;
+			if (framebuffer) {
+				std::memcpy(framebuffer, slot.framebuffer, sizeof(slot.framebuffer));
+			}
+			if (ram) {
+				std::memcpy(ram, slot_ram(slot), header.ram_size);
+			}
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == before) {
+				return before;
+			}
+		}
+		return 0;
+	}
+
+}
@@ -8,7 +8,7 @@ int main(int argc, char** argv) {
 	auto overall_start = std::chrono::high_resolution_clock::now();
 	
 	auto all_passed = true;
-	int total_test_suites = 3;
+	int total_test_suites = 17;
 	int passed_suites = 0;
 
 	std::cout << termcolor::cyan << "   Running " << total_test_suites << " test suites..." << termcolor::reset << "\n\n";
@@ -35,6 +35,118 @@ int main(int argc, char** argv) {
 	} else {
 		all_passed = false;
 	}
+	std::cout << "\n";
+
+	// PPU tests
+	if (run_ppu_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// PPU worker tests
+	if (run_ppu_worker_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// APU tests
+	if (run_apu_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Resampler tests
+	if (run_resampler_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// APU worker tests
+	if (run_apu_worker_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Capture tests
+	if (run_capture_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Savestate tests
+	if (run_savestate_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Rewind tests
+	if (run_rewind_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Clone tests
+	if (run_clone_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Movie tests
+	if (run_movie_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Run batch tests
+	if (run_batch_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Run lockstep tests
+	if (run_lockstep_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Run vector env tests
+	if (run_vector_env_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
+	std::cout << "\n";
+
+	// Run RAM gather tests
+	if (run_ram_gather_tests()) {
+		passed_suites++;
+	} else {
+		all_passed = false;
+	}
 
 	auto overall_end = std::chrono::high_resolution_clock::now();
 	auto overall_duration = std::chrono::duration_cast<std::chrono::milliseconds>(overall_end - overall_start);
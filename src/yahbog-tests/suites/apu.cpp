@@ -0,0 +1,294 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	// The frame sequencer clocks the length counters every other step
+	constexpr std::size_t frame_sequencer_period = 8192;
+	constexpr std::size_t length_period = frame_sequencer_period * 2;
+
+	struct channel_regs {
+		std::string_view name;
+		std::uint16_t nrx0;
+		std::uint8_t status_bit;
+		std::size_t max_length;
+	};
+
+	constexpr std::array channels{
+		channel_regs{ "square 1", 0xFF10, 0x01, 64 },
+		channel_regs{ "square 2", 0xFF15, 0x02, 64 },
+		channel_regs{ "wave",     0xFF1A, 0x04, 256 },
+		channel_regs{ "noise",    0xFF1F, 0x08, 64 },
+	};
+
+	// Bits of NR10-NR51 that always read back as 1
+	constexpr std::array<std::uint8_t, 0x16> read_masks{
+		0x80, 0x3F, 0x00, 0xFF, 0xBF,
+		0xFF, 0x3F, 0x00, 0xFF, 0xBF,
+		0x7F, 0xFF, 0x9F, 0xFF, 0xBF,
+		0xFF, 0xFF, 0x00, 0x00, 0xBF,
+		0x00, 0x00,
+	};
+
+	// Runs the machine for a number of T-cycles
+	void advance(yahbog::emulator& emu, std::size_t cycles) {
+		emu.run_cycles(cycles / 4);
+	}
+
+	// A post-boot emulator idling in a loop, whose APU was just powered on so
+	// that the frame sequencer is at step 0
+	std::unique_ptr<yahbog::emulator> make_emulator() {
+		std::vector<std::uint8_t> rom(0x8000);
+		// di; jr -2
+		rom[0x100] = 0xF3;
+		rom[0x101] = 0x18;
+		rom[0x102] = 0xFE;
+
+		auto emu = std::make_unique<yahbog::emulator>();
+		emu->rom.load_rom(std::move(rom));
+		emu->reset();
+		emu->mmu.write(0xFF26, 0x00);
+		emu->mmu.write(0xFF26, 0x80);
+		return emu;
+	}
+
+	void enable_dac(yahbog::emulator& emu, const channel_regs& ch) {
+		if (ch.nrx0 == 0xFF1A) {
+			emu.mmu.write(0xFF1A, 0x80);
+		}
+		else {
+			emu.mmu.write(ch.nrx0 + 2, 0xF0);
+		}
+	}
+
+	void disable_dac(yahbog::emulator& emu, const channel_regs& ch) {
+		emu.mmu.write(ch.nrx0 == 0xFF1A ? 0xFF1A : ch.nrx0 + 2, 0x00);
+	}
+
+	std::uint8_t status(yahbog::emulator& emu) {
+		return emu.mmu.read(0xFF26) & 0x0F;
+	}
+
+	// NR52 follows triggers, the DACs and the power switch
+	std::string run_nr52() {
+		auto emu = make_emulator();
+		if (emu->mmu.read(0xFF26) != 0xF0) {
+			return std::format("NR52 reads {:02X} after power on", emu->mmu.read(0xFF26));
+		}
+
+		std::uint8_t expected = 0;
+		for (const auto& ch : channels) {
+			// a trigger with the DAC off does not start the channel
+			emu->mmu.write(ch.nrx0 + 4, 0x80);
+			if (status(*emu) != expected) {
+				return std::format("{} started with its DAC off", ch.name);
+			}
+
+			enable_dac(*emu, ch);
+			emu->mmu.write(ch.nrx0 + 4, 0x80);
+			expected |= ch.status_bit;
+			if (status(*emu) != expected) {
+				return std::format("NR52 status is {:X} after triggering {}", status(*emu), ch.name);
+			}
+		}
+
+		// the status bits are read-only
+		emu->mmu.write(0xFF26, 0x80);
+		if (status(*emu) != 0x0F) {
+			return "writing NR52 changed the channel status";
+		}
+
+		for (const auto& ch : channels) {
+			disable_dac(*emu, ch);
+			expected &= ~ch.status_bit;
+			if (status(*emu) != expected) {
+				return std::format("turning the DAC of {} off left NR52 status at {:X}", ch.name, status(*emu));
+			}
+		}
+
+		// powering off clears the registers and ignores writes until powered on
+		emu->mmu.write(0xFF24, 0x77);
+		emu->mmu.write(0xFF26, 0x00);
+		if (emu->mmu.read(0xFF26) != 0x70 || emu->mmu.read(0xFF24) != 0x00) {
+			return "powering off did not clear NR50 and NR52";
+		}
+		emu->mmu.write(0xFF24, 0x55);
+		emu->mmu.write(0xFF26, 0x80);
+		if (emu->mmu.read(0xFF24) != 0x00) {
+			return "NR50 was written while the APU was off";
+		}
+		return {};
+	}
+
+	// Unused and write-only bits read back as 1
+	std::string run_read_masks() {
+		auto emu = make_emulator();
+		for (const std::uint8_t value : { std::uint8_t{ 0x00 }, std::uint8_t{ 0xFF } }) {
+			for (std::uint16_t addr = 0xFF10; addr < 0xFF26; addr++) {
+				emu->mmu.write(addr, value);
+			}
+			for (std::uint16_t addr = 0xFF10; addr < 0xFF26; addr++) {
+				const auto expected = static_cast<std::uint8_t>(value | read_masks[addr - 0xFF10]);
+				if (emu->mmu.read(addr) != expected) {
+					return std::format("{:04X} reads {:02X} after writing {:02X}, expected {:02X}",
+						addr, emu->mmu.read(addr), value, expected);
+				}
+			}
+		}
+		return {};
+	}
+
+	// Triggers ch with the length counter at length and enabled, then returns
+	// how many T-cycles later the channel stopped
+	std::size_t time_until_silent(yahbog::emulator& emu, const channel_regs& ch, std::size_t length) {
+		enable_dac(emu, ch);
+		emu.mmu.write(ch.nrx0 + 1, static_cast<std::uint8_t>(ch.max_length - length));
+		emu.mmu.write(ch.nrx0 + 4, 0xC0);
+
+		std::size_t elapsed = 0;
+		while (status(emu) & ch.status_bit) {
+			advance(emu, 4);
+			elapsed += 4;
+		}
+		return elapsed;
+	}
+
+	// A channel stops when its length counter runs out, on the frame sequencer
+	// steps that clock it
+	std::string run_length() {
+		for (const auto& ch : channels) {
+			for (const std::size_t length : { std::size_t{ 1 }, std::size_t{ 3 }, ch.max_length }) {
+				auto emu = make_emulator();
+				const auto elapsed = time_until_silent(*emu, ch, length);
+				const auto expected = frame_sequencer_period + (length - 1) * length_period;
+				if (elapsed != expected) {
+					return std::format("{} with length {} stopped after {} cycles, expected {}", ch.name, length, elapsed, expected);
+				}
+			}
+
+			// without the length enable bit it keeps playing
+			auto emu = make_emulator();
+			enable_dac(*emu, ch);
+			emu->mmu.write(ch.nrx0 + 1, static_cast<std::uint8_t>(ch.max_length - 1));
+			emu->mmu.write(ch.nrx0 + 4, 0x80);
+			advance(*emu, 4 * length_period);
+			if (!(status(*emu) & ch.status_bit)) {
+				return std::format("{} stopped with its length counter disabled", ch.name);
+			}
+		}
+		return {};
+	}
+
+	// Enabling the length counter when the next step does not clock it clocks it once more
+	std::string run_length_quirk() {
+		for (const auto& ch : channels) {
+			auto emu = make_emulator();
+			advance(*emu, frame_sequencer_period);
+
+			const auto elapsed = time_until_silent(*emu, ch, 3);
+			if (elapsed != 2 * length_period) {
+				return std::format("{} stopped after {} cycles, expected {}", ch.name, elapsed, 2 * length_period);
+			}
+		}
+		return {};
+	}
+
+	void drain(yahbog::apu& spu, std::vector<std::int16_t>& out) {
+		std::vector<std::int16_t> chunk(spu.samples_available() * 2);
+		const auto frames = spu.read_samples(chunk);
+		out.insert(out.end(), chunk.begin(), chunk.begin() + frames * 2);
+	}
+
+	// Catching up only on access or drain produces the same samples as syncing
+	// on every machine cycle, however rarely the samples are drained
+	std::string run_lazy_sync() {
+		auto lazy = TestSuite::create_activity_emulator();
+		auto eager = TestSuite::create_activity_emulator();
+		auto batched = TestSuite::create_activity_emulator();
+
+		std::vector<std::int16_t> lazy_samples;
+		std::vector<std::int16_t> eager_samples;
+		std::vector<std::int16_t> batched_samples;
+
+		for (std::size_t frame = 0; frame < 120; frame++) {
+			const auto cycles = lazy->run_frame();
+			for (std::size_t i = 0; i < cycles; i++) {
+				eager->tick();
+				eager->spu.sync();
+			}
+			batched->run_frame();
+
+			drain(lazy->spu, lazy_samples);
+			drain(eager->spu, eager_samples);
+			if (frame % 5 == 4) {
+				drain(batched->spu, batched_samples);
+			}
+		}
+		drain(batched->spu, batched_samples);
+
+		if (lazy_samples.empty()) {
+			return "no samples were produced";
+		}
+		if (std::ranges::all_of(lazy_samples, [](std::int16_t s) { return s == 0; })) {
+			return "only silence was produced";
+		}
+		if (lazy_samples != eager_samples) {
+			const auto [a, b] = std::ranges::mismatch(lazy_samples, eager_samples);
+			return std::format("syncing every cycle differs from sample {}", a - lazy_samples.begin());
+		}
+		if (lazy_samples != batched_samples) {
+			const auto [a, b] = std::ranges::mismatch(lazy_samples, batched_samples);
+			return std::format("draining every 5 frames differs from sample {}", a - lazy_samples.begin());
+		}
+		return {};
+	}
+
+	// Without synthesis every sound register and wave RAM read still sees the
+	// same machine, including the wave sample being played
+	std::string run_synthesis_off() {
+		auto on = TestSuite::create_activity_emulator();
+		auto off = TestSuite::create_activity_emulator();
+		off->spu.set_synthesis(false);
+
+		// read in the middle of frames, while the channels play
+		constexpr std::size_t chunk = 1001;
+		for (std::size_t cycle = 0; cycle < 120 * yahbog::emulator::cycles_per_frame; cycle += chunk) {
+			on->run_cycles(chunk);
+			off->run_cycles(chunk);
+			for (std::uint16_t addr = 0xFF10; addr <= 0xFF3F; addr++) {
+				if (on->mmu.read(addr) != off->mmu.read(addr)) {
+					return std::format("{:04X} differs after {} cycles", addr, cycle + chunk);
+				}
+			}
+		}
+
+		if (off->spu.samples_available() != 0) {
+			return "samples were produced without synthesis";
+		}
+		return {};
+	}
+
+	constexpr std::array<std::pair<std::string_view, std::string(*)()>, 6> cases{ {
+		{ "NR52",          run_nr52 },
+		{ "read masks",    run_read_masks },
+		{ "length",        run_length },
+		{ "length quirk",  run_length_quirk },
+		{ "lazy sync",     run_lazy_sync },
+		{ "synthesis off", run_synthesis_off },
+	} };
+
+}
+
+bool run_apu_tests() {
+	TestSuite::test_suite_runner suite("APU Tests");
+	suite.start();
+
+	suite.print_info("🔍 Checking the APU in " + std::to_string(cases.size()) + " cases");
+	std::cout << "\n";
+
+	for (const auto& [name, run] : cases) {
+		TestSuite::run_test(suite, name, run);
+	}
+
+	suite.finish();
+	return suite.passed();
+}
@@ -0,0 +1,96 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	struct worker_case {
+		std::string_view name;
+
+		std::size_t frames;
+		// frame before which the worker takes over synthesis
+		std::size_t attach_at;
+		// samples are drained after every drain_every-th frame
+		std::size_t drain_every;
+	};
+
+	constexpr std::array cases{
+		worker_case{ "from the start",         240, 0,   1 },
+		worker_case{ "attached mid-run",       240, 100, 1 },
+		worker_case{ "drained every 9 frames", 240, 0,   9 },
+	};
+
+	void drain(yahbog::apu& spu, std::vector<std::int16_t>& out) {
+		std::vector<std::int16_t> chunk(spu.samples_available() * 2);
+		const auto frames = spu.read_samples(chunk);
+		out.insert(out.end(), chunk.begin(), chunk.begin() + frames * 2);
+	}
+
+	void drain(yahbog::apu_worker& worker, std::vector<std::int16_t>& out) {
+		std::vector<std::int16_t> chunk(4096);
+		while (const auto frames = worker.read_samples(chunk)) {
+			out.insert(out.end(), chunk.begin(), chunk.begin() + frames * 2);
+		}
+	}
+
+	// Runs the same ROM with inline synthesis and with an apu_worker,
+	// checking that the emulated state matches after every frame and that both
+	// produce the same samples
+	std::string run_case(const worker_case& c) {
+		auto inline_emu = TestSuite::create_activity_emulator();
+		auto threaded_emu = TestSuite::create_activity_emulator();
+		std::unique_ptr<yahbog::apu_worker> worker;
+
+		std::vector<std::int16_t> inline_samples;
+		std::vector<std::int16_t> threaded_samples;
+
+		for (std::size_t frame = 0; frame < c.frames; frame++) {
+			if (frame == c.attach_at) {
+				worker = std::make_unique<yahbog::apu_worker>(threaded_emu->spu);
+			}
+
+			inline_emu->run_frame();
+			threaded_emu->run_frame();
+
+			if (frame % c.drain_every == c.drain_every - 1) {
+				drain(inline_emu->spu, inline_samples);
+				if (worker) {
+					threaded_emu->spu.flush();
+					worker->wait_idle();
+					drain(*worker, threaded_samples);
+				}
+				else {
+					drain(threaded_emu->spu, threaded_samples);
+				}
+			}
+
+			if (inline_emu->state_hash() != threaded_emu->state_hash()) {
+				return std::format("emulated state diverged at frame {}", frame);
+			}
+		}
+
+		if (inline_samples.empty()) {
+			return "no samples were produced";
+		}
+		if (inline_samples != threaded_samples) {
+			const auto [a, b] = std::ranges::mismatch(inline_samples, threaded_samples);
+			return std::format("samples differ from sample {} ({} inline, {} threaded)",
+				a - inline_samples.begin(), inline_samples.size(), threaded_samples.size());
+		}
+		return {};
+	}
+
+}
+
+bool run_apu_worker_tests() {
+	TestSuite::test_suite_runner suite("APU Worker Tests");
+	suite.start();
+
+	suite.print_info("🔍 Comparing inline synthesis against an apu_worker in " + std::to_string(cases.size()) + " runs");
+	std::cout << "\n";
+
+	for (const auto& c : cases) {
+		TestSuite::run_test(suite, c.name, [&] { return run_case(c); });
+	}
+
+	suite.finish();
+	return suite.passed();
+}
@@ -0,0 +1,180 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	// Every index runs exactly once, whatever the share of each thread, and
+	// the pool can be reused for loops of any size
+	std::string run_every_index() {
+		for (const std::size_t threads : { std::size_t{ 1 }, std::size_t{ 3 }, std::size_t{ 8 } }) {
+			yahbog::thread_pool pool(threads);
+			if (pool.size() != threads) {
+				return std::format("a pool of {} threads has {} slots", threads, pool.size());
+			}
+
+			for (const std::size_t count : { std::size_t{ 0 }, std::size_t{ 1 }, std::size_t{ 2 }, std::size_t{ 7 }, std::size_t{ 1000 } }) {
+				std::vector<std::atomic<std::uint32_t>> runs(count);
+				pool.parallel_for(count, [&](std::size_t i) {
+					// uneven tasks, so that idle threads steal
+					if (i % 5 == 0) {
+						std::this_thread::sleep_for(std::chrono::microseconds(50));
+					}
+					runs[i]++;
+				});
+
+				for (std::size_t i = 0; i < count; i++) {
+					if (runs[i] != 1) {
+						return std::format("with {} threads and {} tasks, index {} ran {} times", threads, count, i, runs[i].load());
+					}
+				}
+			}
+		}
+		return {};
+	}
+
+	// Tasks that throw do not stop the others, and the first exception comes
+	// out of parallel_for
+	std::string run_exceptions() {
+		// on one thread the indices run in order, so the first to throw is known
+		{
+			yahbog::thread_pool pool(1);
+			std::size_t ran = 0;
+			try {
+				pool.parallel_for(10, [&](std::size_t i) {
+					ran++;
+					if (i == 3 || i == 7) {
+						throw std::runtime_error(std::to_string(i));
+					}
+				});
+				return "no exception was rethrown";
+			}
+			catch (const std::runtime_error& e) {
+				if (std::string_view(e.what()) != "3") {
+					return std::format("exception {} was rethrown, expected 3", e.what());
+				}
+			}
+			if (ran != 10) {
+				return std::format("{} of 10 tasks ran", ran);
+			}
+		}
+
+		yahbog::thread_pool pool(4);
+		std::atomic<std::size_t> ran = 0;
+		try {
+			pool.parallel_for(100, [&](std::size_t i) {
+				ran++;
+				if (i % 10 == 0) {
+					throw std::runtime_error("task failed");
+				}
+			});
+			return "no exception was rethrown";
+		}
+		catch (const std::runtime_error&) {}
+		if (ran != 100) {
+			return std::format("{} of 100 tasks ran", ran.load());
+		}
+
+		// the error does not leak into the next loop
+		try {
+			pool.parallel_for(100, [](std::size_t) {});
+		}
+		catch (const std::exception&) {
+			return "a loop that threw nothing rethrew the previous error";
+		}
+		return {};
+	}
+
+	std::uint8_t buttons_at(std::size_t instance, std::size_t step) {
+		return static_cast<std::uint8_t>((step / 7 + instance) * 0x29);
+	}
+
+	// Stepping instances on the pool gives the same machines, frames and
+	// outputs as stepping clones one after the other
+	std::string run_matches_serial() {
+		constexpr std::size_t instances = 6;
+		constexpr std::size_t steps = 90;
+		constexpr std::size_t cycle_budget = 12345;
+
+		auto prototype = TestSuite::create_activity_emulator();
+		for (std::size_t frame = 0; frame < 10; frame++) {
+			prototype->run_frame();
+		}
+
+		yahbog::batch_runner batch(*prototype, instances, 3);
+		std::vector<std::unique_ptr<yahbog::emulator>> serial;
+		for (std::size_t i = 0; i < instances; i++) {
+			serial.push_back(prototype->clone());
+			serial.back()->spu.set_synthesis(false);
+		}
+
+		for (std::size_t step = 0; step < steps; step++) {
+			// alternate whole frames with a budget that ends mid-frame
+			const bool frames = step % 3 != 2;
+			for (std::size_t i = 0; i < instances; i++) {
+				batch.buttons()[i] = buttons_at(i, step);
+			}
+			if (frames) {
+				batch.run_frame();
+			}
+			else {
+				batch.run_cycles(cycle_budget);
+			}
+
+			for (std::size_t i = 0; i < instances; i++) {
+				auto& emu = *serial[i];
+				emu.set_buttons(buttons_at(i, step));
+				std::size_t cycles = cycle_budget;
+				if (frames) {
+					cycles = emu.run_frame();
+				}
+				else {
+					emu.run_cycles(cycle_budget);
+				}
+
+				if (batch.cycles()[i] != cycles) {
+					return std::format("instance {} ran {} cycles in step {}, expected {}", i, batch.cycles()[i], step, cycles);
+				}
+				if (batch[i].state_hash() != emu.state_hash()) {
+					return std::format("instance {} diverged in step {}", i, step);
+				}
+				if (batch.frame_hashes()[i] != emu.ppu.frame_hash()) {
+					return std::format("instance {} reports another frame hash in step {}", i, step);
+				}
+				const auto frame = batch.framebuffers().subspan(i * yahbog::gpu::framebuffer_size, yahbog::gpu::framebuffer_size);
+				if (!std::ranges::equal(frame, emu.ppu.framebuffer())) {
+					return std::format("instance {} reports another framebuffer in step {}", i, step);
+				}
+			}
+		}
+
+		// the instances were driven apart, so the comparison above meant something
+		if (batch.frame_hashes()[0] == batch.frame_hashes()[1] && batch[0].state_hash() == batch[1].state_hash()) {
+			return "instances with different buttons ended up identical";
+		}
+		if (batch[0].spu.synthesis()) {
+			return "an instance synthesizes audio";
+		}
+		return {};
+	}
+
+	constexpr std::array<std::pair<std::string_view, std::string(*)()>, 3> cases{ {
+		{ "every index once", run_every_index },
+		{ "exceptions",       run_exceptions },
+		{ "matches serial",   run_matches_serial },
+	} };
+
+}
+
+bool run_batch_tests() {
+	TestSuite::test_suite_runner suite("Batch Tests");
+	suite.start();
+
+	suite.print_info("🔍 Checking the thread pool and batch runner in " + std::to_string(cases.size()) + " cases");
+	std::cout << "\n";
+
+	for (const auto& [name, run] : cases) {
+		TestSuite::run_test(suite, name, run);
+	}
+
+	suite.finish();
+	return suite.passed();
+}
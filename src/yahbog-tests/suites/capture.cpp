@@ -0,0 +1,200 @@
+#include <yahbog-tests.h>
+
+#include <fstream>
+
+namespace {
+
+	using packed_frame = yahbog::gpu::framebuffer_t;
+
+	constexpr std::size_t luma_size = yahbog::gpu::screen_width * yahbog::gpu::screen_height;
+
+	// A capture file in the temporary directory, removed when the test ends
+	struct temp_file {
+		std::filesystem::path path;
+
+		explicit temp_file(std::string_view name)
+			: path(std::filesystem::temp_directory_path() / std::format("yahbog-capture-{}.y4m", name)) {}
+		~temp_file() {
+			std::error_code ec;
+			std::filesystem::remove(path, ec);
+		}
+	};
+
+	// Splits a Y4M stream into its frames
+	std::vector<std::vector<std::uint8_t>> read_y4m(const std::filesystem::path& path) {
+		std::ifstream in(path, std::ios::binary);
+		std::string header;
+		std::getline(in, header);
+		if (!header.starts_with("YUV4MPEG2 W160 H144 ")) {
+			throw std::runtime_error("the capture has no Y4M header");
+		}
+
+		std::vector<std::vector<std::uint8_t>> frames;
+		std::string frame_header;
+		while (std::getline(in, frame_header)) {
+			if (frame_header != "FRAME") {
+				throw std::runtime_error(std::format("frame {} has no FRAME header", frames.size()));
+			}
+			auto& luma = frames.emplace_back(luma_size);
+			if (!in.read(reinterpret_cast<char*>(luma.data()), luma_size)) {
+				throw std::runtime_error(std::format("frame {} is truncated", frames.size() - 1));
+			}
+		}
+		return frames;
+	}
+
+	std::vector<std::uint8_t> to_luma(const packed_frame& frame) {
+		std::vector<std::uint8_t> luma(luma_size);
+		for (std::size_t i = 0; i < luma_size; i++) {
+			const auto shade = (frame[i / 4] >> (6 - (i % 4) * 2)) & 0b11;
+			luma[i] = static_cast<std::uint8_t>(255 - shade * 85);
+		}
+		return luma;
+	}
+
+	// Frames pushed from a gpu are the ones it drew, whether into framebuffer()
+	// or into a registered packed output, with or without a ppu_worker
+	std::string run_frames() {
+		constexpr std::size_t stride = 48;
+		constexpr std::size_t output_from = 20;
+		constexpr std::size_t worker_from = 40;
+		constexpr std::size_t frames = 60;
+
+		temp_file file("frames");
+		auto reference = TestSuite::create_activity_emulator();
+		auto emu = TestSuite::create_activity_emulator();
+		std::vector<std::uint8_t> buffers[2];
+		std::unique_ptr<yahbog::ppu_worker> worker;
+
+		std::vector<std::vector<std::uint8_t>> expected;
+		{
+			yahbog::capture cap({ .video = file.path });
+			for (std::size_t frame = 0; frame < frames; frame++) {
+				if (frame == output_from) {
+					yahbog::frame_output output{ .stride = stride };
+					for (std::size_t b = 0; b < 2; b++) {
+						buffers[b].assign(stride * yahbog::gpu::screen_height, 0xA5);
+						output.buffers[b] = buffers[b];
+					}
+					emu->ppu.set_output(output);
+				}
+				if (frame == worker_from) {
+					worker = std::make_unique<yahbog::ppu_worker>(emu->ppu);
+				}
+
+				reference->run_frame();
+				emu->run_frame();
+				if (worker) {
+					worker->sync();
+				}
+
+				if (!cap.push_frame(emu->ppu)) {
+					return std::format("frame {} was dropped", frame);
+				}
+				expected.push_back(to_luma(reference->ppu.framebuffer()));
+			}
+			worker.reset();
+			cap.close();
+
+			if (cap.frames_written() != frames) {
+				return std::format("{} frames were written, expected {}", cap.frames_written(), frames);
+			}
+		}
+
+		const auto written = read_y4m(file.path);
+		if (written.size() != frames) {
+			return std::format("the file holds {} frames, expected {}", written.size(), frames);
+		}
+		for (std::size_t frame = 0; frame < frames; frame++) {
+			if (written[frame] != expected[frame]) {
+				return std::format("frame {} differs from the drawn frame", frame);
+			}
+		}
+		return {};
+	}
+
+	// Only frames that differ from the last queued one are written, also once
+	// frame hashing is off
+	std::string run_deduplicate() {
+		temp_file file("dedup");
+		auto emu = TestSuite::create_activity_emulator();
+		// past the frame the LCD is turned on in, which is only partly drawn
+		for (std::size_t frame = 0; frame < 10; frame++) {
+			emu->run_frame();
+		}
+
+		std::size_t expected = 0;
+		std::optional<packed_frame> last;
+		yahbog::capture cap({ .video = file.path, .deduplicate = true });
+		for (std::size_t frame = 0; frame < 60; frame++) {
+			if (frame == 30) {
+				emu->ppu.set_frame_hashing(false);
+			}
+			emu->run_frame();
+
+			// every frame twice, so at least the second is a repeat
+			for (std::size_t i = 0; i < 2; i++) {
+				if (!last || *last != emu->ppu.framebuffer()) {
+					expected++;
+				}
+				last = emu->ppu.framebuffer();
+				cap.push_frame(emu->ppu);
+			}
+		}
+		cap.close();
+
+		if (cap.frames_written() != expected) {
+			return std::format("{} frames were written, expected {}", cap.frames_written(), expected);
+		}
+		if (cap.frames_written() + cap.frames_deduplicated() != 120) {
+			return std::format("{} frames were written and {} skipped out of 120", cap.frames_written(), cap.frames_deduplicated());
+		}
+		return {};
+	}
+
+	// Outputs that are not packed shades cannot be captured from the gpu, and
+	// unopenable paths are refused
+	std::string run_rejects() {
+		temp_file file("rejects");
+		auto emu = TestSuite::create_activity_emulator();
+		std::vector<std::uint8_t> buffer(yahbog::gpu::screen_width * yahbog::gpu::screen_height * 4);
+		emu->ppu.set_output({ .format = yahbog::pixel_format::rgba8888, .buffers = { buffer } });
+		emu->run_frame();
+
+		yahbog::capture cap({ .video = file.path });
+		try {
+			cap.push_frame(emu->ppu);
+			return "a frame was captured from an rgba8888 output";
+		}
+		catch (const std::invalid_argument&) {}
+
+		try {
+			yahbog::capture bad({ .video = file.path / "missing" / "out.y4m" });
+			return "an unopenable path was accepted";
+		}
+		catch (const std::runtime_error&) {}
+		return {};
+	}
+
+	constexpr std::array<std::pair<std::string_view, std::string(*)()>, 3> cases{ {
+		{ "frames",      run_frames },
+		{ "deduplicate", run_deduplicate },
+		{ "rejects",     run_rejects },
+	} };
+
+}
+
+bool run_capture_tests() {
+	TestSuite::test_suite_runner suite("Capture Tests");
+	suite.start();
+
+	suite.print_info("🔍 Checking captured frames in " + std::to_string(cases.size()) + " cases");
+	std::cout << "\n";
+
+	for (const auto& [name, run] : cases) {
+		TestSuite::run_test(suite, name, run);
+	}
+
+	suite.finish();
+	return suite.passed();
+}
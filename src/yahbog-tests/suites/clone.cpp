@@ -0,0 +1,145 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	struct clone_case {
+		std::string_view name;
+
+		// frames the original runs before it is cloned
+		std::size_t clone_at;
+		// clone the clone instead, to check that copies of copies are as good
+		bool second_generation;
+		// the original renders through a ppu_worker, which the clone must not use
+		bool worker;
+	};
+
+	constexpr std::array cases{
+		clone_case{ "after reset",        0,  false, false },
+		clone_case{ "mid-run",            90, false, false },
+		clone_case{ "clone of a clone",   90, true,  false },
+		clone_case{ "deferred rendering", 90, false, true },
+	};
+
+	constexpr std::size_t frames_after = 120;
+
+	// Clones an emulator partway through, then drives the clone with other
+	// buttons and bus writes. The original must keep matching a twin that was
+	// never cloned, and the clone must match an emulator restored from a
+	// savestate taken at the moment of cloning and driven the same way.
+	std::string run_case(const clone_case& c) {
+		auto original = TestSuite::create_activity_emulator();
+		auto twin = TestSuite::create_activity_emulator();
+
+		std::size_t hooked_writes = 0;
+		original->hook_writing([&hooked_writes](std::uint16_t, std::uint8_t) {
+			hooked_writes++;
+			return false;
+		});
+
+		std::unique_ptr<yahbog::ppu_worker> worker;
+		if (c.worker) {
+			worker = std::make_unique<yahbog::ppu_worker>(original->ppu);
+		}
+
+		for (std::size_t frame = 0; frame < c.clone_at; frame++) {
+			const auto buttons = static_cast<std::uint8_t>(frame / 5 * 0x29);
+			original->set_buttons(buttons);
+			twin->set_buttons(buttons);
+			original->run_frame();
+			twin->run_frame();
+		}
+		if (worker) {
+			worker->sync();
+		}
+
+		auto clone = original->clone();
+		if (c.second_generation) {
+			clone = clone->clone();
+		}
+
+		if (clone->rom.image() != original->rom.image()) {
+			return "the clone copied the ROM image instead of sharing it";
+		}
+		if (clone->state_hash() != original->state_hash()) {
+			return "the clone starts in a different state";
+		}
+		if (clone->ppu.rendering_deferred()) {
+			return "the clone took over the original's ppu_worker";
+		}
+
+		// the twin is in the same state and renders inline, so its savestate
+		// also carries a finished framebuffer
+		auto restored = TestSuite::create_activity_emulator();
+		restored->load_state(TestSuite::save(*twin));
+
+		const auto writes_before = hooked_writes;
+		std::size_t frames_drawn = clone->ppu.frames();
+		std::uint32_t seed = 0x6C078965;
+
+		for (std::size_t frame = 0; frame < frames_after; frame++) {
+			const auto buttons = static_cast<std::uint8_t>(frame / 5 * 0x29);
+			original->set_buttons(buttons);
+			twin->set_buttons(buttons);
+			clone->set_buttons(static_cast<std::uint8_t>(~buttons));
+			restored->set_buttons(static_cast<std::uint8_t>(~buttons));
+
+			// scribble over work RAM and high RAM through the clone's bus only
+			for (int i = 0; i < 8; i++) {
+				seed = seed * 1664525 + 1013904223;
+				const auto addr = static_cast<std::uint16_t>((seed & 0x100) ? 0xC000 + (seed >> 20) : 0xFF80 + ((seed >> 24) & 0x7E));
+				const auto value = static_cast<std::uint8_t>(seed >> 9);
+				clone->writer(addr, value);
+				restored->writer(addr, value);
+			}
+
+			original->run_frame();
+			twin->run_frame();
+			clone->run_frame();
+			restored->run_frame();
+
+			if (original->state_hash() != twin->state_hash()) {
+				return std::format("the original diverged {} frames after cloning", frame);
+			}
+			if (clone->state_hash() != restored->state_hash()) {
+				return std::format("the clone diverged from a restored state {} frames after cloning", frame);
+			}
+			if (clone->ppu.frames() != frames_drawn) {
+				frames_drawn = clone->ppu.frames();
+				if (clone->ppu.framebuffer() != restored->ppu.framebuffer()) {
+					return std::format("the clone drew a different frame {} frames after cloning", frame);
+				}
+			}
+		}
+
+		if (clone->state_hash() == original->state_hash()) {
+			return "the clone never diverged from the original";
+		}
+		if (hooked_writes == writes_before) {
+			return "the original's write hook stopped firing";
+		}
+
+		// the clone's bus has no hook, so only the original's own writes count
+		const auto writes_after = hooked_writes;
+		clone->writer(0xC000, 0x42);
+		if (hooked_writes != writes_after) {
+			return "the clone's writes reached the original's hook";
+		}
+		return {};
+	}
+
+}
+
+bool run_clone_tests() {
+	TestSuite::test_suite_runner suite("Clone Tests");
+	suite.start();
+
+	suite.print_info("🔍 Driving clones apart from their originals in " + std::to_string(cases.size()) + " runs");
+	std::cout << "\n";
+
+	for (const auto& c : cases) {
+		TestSuite::run_test(suite, c.name, [&] { return run_case(c); });
+	}
+
+	suite.finish();
+	return suite.passed();
+}
@@ -0,0 +1,135 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	// A post-boot emulator idling in a loop, on which buttons leave no trace
+	// once released, since no joypad line is selected
+	std::unique_ptr<yahbog::emulator> make_idle_emulator() {
+		std::vector<std::uint8_t> rom(0x8000);
+		// di; jr -2
+		rom[0x100] = 0xF3;
+		rom[0x101] = 0x18;
+		rom[0x102] = 0xFE;
+
+		auto emu = std::make_unique<yahbog::emulator>();
+		emu->rom.load_rom(std::move(rom));
+		emu->reset();
+		return emu;
+	}
+
+	// Lanes are read-only views, so they are compared with their emulators by
+	// what can be seen without stepping: the CPU, the buttons and the frame
+	std::string compare_lane(const yahbog::emulator& lane, const yahbog::emulator& own) {
+		const auto& a = lane.z80.r();
+		const auto& b = own.z80.r();
+		if (lane.z80.cycles() != own.z80.cycles() || a.pc != b.pc || a.sp != b.sp ||
+			a.af() != b.af() || a.bc() != b.bc() || a.de() != b.de() || a.hl() != b.hl()) {
+			return "the CPU differs";
+		}
+		if (lane.pad.buttons() != own.pad.buttons()) {
+			return "the buttons differ";
+		}
+		if (lane.ppu.frame_hash() != own.ppu.frame_hash() || lane.ppu.framebuffer() != own.ppu.framebuffer()) {
+			return "the frame differs";
+		}
+		return {};
+	}
+
+	// Steps a lockstep_runner and one emulator per lane with the same buttons,
+	// checking every lane against its own emulator after each step
+	struct lockstep_check {
+		yahbog::lockstep_runner runner;
+		std::vector<std::unique_ptr<yahbog::emulator>> serial;
+
+		lockstep_check(const yahbog::emulator& prototype, std::size_t lanes) : runner(prototype, lanes) {
+			for (std::size_t i = 0; i < lanes; i++) {
+				serial.push_back(prototype.clone());
+			}
+		}
+
+		template<typename Buttons>
+		std::string run_frames(std::size_t frames, Buttons buttons) {
+			for (std::size_t frame = 0; frame < frames; frame++) {
+				for (std::size_t i = 0; i < serial.size(); i++) {
+					runner.buttons()[i] = buttons(i, frame);
+					serial[i]->set_buttons(buttons(i, frame));
+					serial[i]->run_frame();
+				}
+				runner.run_frame();
+
+				for (std::size_t i = 0; i < serial.size(); i++) {
+					if (auto failure = compare_lane(runner.lane(i), *serial[i]); !failure.empty()) {
+						return std::format("lane {} diverged from its own emulator in frame {}: {}", i, frame, failure);
+					}
+				}
+			}
+			return {};
+		}
+	};
+
+	// Lanes given the same buttons share one instance, split when their
+	// buttons differ and merge again once their states are equal
+	std::string run_split_merge() {
+		constexpr std::size_t lanes = 8;
+		auto prototype = make_idle_emulator();
+		lockstep_check check(*prototype, lanes);
+
+		if (auto failure = check.run_frames(5, [](std::size_t, std::size_t) { return std::uint8_t{ 0 }; }); !failure.empty()) {
+			return failure;
+		}
+		if (check.runner.groups() != 1) {
+			return std::format("{} groups run lanes that were never given buttons", check.runner.groups());
+		}
+
+		// four distinct button masks, two lanes each
+		const auto pressed = [](std::size_t lane, std::size_t) { return static_cast<std::uint8_t>(1 << (lane % 4)); };
+		if (auto failure = check.run_frames(5, pressed); !failure.empty()) {
+			return failure;
+		}
+		if (check.runner.groups() != 4) {
+			return std::format("{} groups run lanes with 4 distinct buttons, expected 4", check.runner.groups());
+		}
+
+		if (auto failure = check.run_frames(1, [](std::size_t, std::size_t) { return std::uint8_t{ 0 }; }); !failure.empty()) {
+			return failure;
+		}
+		if (check.runner.groups() != 1) {
+			return std::format("{} groups are left once every lane released its buttons", check.runner.groups());
+		}
+		return {};
+	}
+
+	// Lanes whose buttons change what the program does run exactly as if each
+	// had its own emulator, whether they are split or share one
+	std::string run_matches_serial() {
+		constexpr std::size_t lanes = 6;
+		auto prototype = TestSuite::create_activity_emulator();
+		lockstep_check check(*prototype, lanes);
+
+		// lanes agree for a while, then pairs of them drift apart at different times
+		return check.run_frames(60, [](std::size_t lane, std::size_t frame) {
+			return static_cast<std::uint8_t>(frame < 10 * (lane / 2 + 1) ? 0 : (frame / 5 + lane) * 0x29);
+		});
+	}
+
+	constexpr std::array<std::pair<std::string_view, std::string(*)()>, 2> cases{ {
+		{ "split and merge", run_split_merge },
+		{ "matches serial",  run_matches_serial },
+	} };
+
+}
+
+bool run_lockstep_tests() {
+	TestSuite::test_suite_runner suite("Lockstep Tests");
+	suite.start();
+
+	suite.print_info("🔍 Checking lockstep lanes in " + std::to_string(cases.size()) + " cases");
+	std::cout << "\n";
+
+	for (const auto& [name, run] : cases) {
+		TestSuite::run_test(suite, name, run);
+	}
+
+	suite.finish();
+	return suite.passed();
+}
@@ -0,0 +1,190 @@
+#include <yahbog-tests.h>
+
+#include <yahbog/utility/varint.h>
+
+namespace {
+
+	struct movie_case {
+		std::string_view name;
+
+		std::size_t keyframe_interval;
+		std::size_t frames;
+	};
+
+	constexpr std::array cases{
+		movie_case{ "keyframe every frame", 1,    40 },
+		movie_case{ "short segments",       16,   200 },
+		movie_case{ "uneven last segment",  64,   150 },
+		movie_case{ "a single segment",     1000, 150 },
+	};
+
+	// Inverts the buttons of the last input event in a segment, so that the
+	// replay reaches the next keyframe with the wrong buttons held. Returns false
+	// if the segment has no input.
+	bool tamper(yahbog::movie& m, std::size_t segment) {
+		const auto* p = m.events.data() + m.index[segment].event_offset;
+		const auto* end = m.events.data() + m.index[segment + 1].event_offset;
+
+		std::optional<std::size_t> last_input;
+		std::uint64_t code = 0;
+		while (yahbog::get_varint(p, end, code)) {
+			if (!(code & 1)) {
+				last_input = p - m.events.data();
+				p++;
+			}
+		}
+
+		if (!last_input) {
+			return false;
+		}
+		m.events[*last_input] = ~m.events[*last_input];
+		return true;
+	}
+
+	// Records a run with the emulated state hashed after every frame, then
+	// replays it, seeks around in it, round-trips it through a file and
+	// verifies it, comparing every state reached against those hashes
+	std::string run_case(const movie_case& c) {
+		auto recorded = TestSuite::create_activity_emulator();
+		for (std::size_t frame = 0; frame < 20; frame++) {
+			recorded->run_frame();
+		}
+
+		yahbog::movie_recorder recorder(*recorded, c.keyframe_interval);
+		std::vector<std::uint64_t> hashes{ recorded->state_hash() };
+		for (std::size_t frame = 0; frame < c.frames; frame++) {
+			recorder.set_buttons(static_cast<std::uint8_t>(frame / 3 * 0x1D));
+			recorder.run_frame();
+			hashes.push_back(recorded->state_hash());
+		}
+		const auto m = recorder.finish();
+
+		if (m.frames != c.frames) {
+			return std::format("recorded {} frames, expected {}", m.frames, c.frames);
+		}
+		if (m.index.size() != (c.frames + c.keyframe_interval - 1) / c.keyframe_interval + 1) {
+			return std::format("recorded {} keyframes", m.index.size());
+		}
+
+		// straight replay, starting from a different state than the recording
+		auto emu = TestSuite::create_activity_emulator();
+		{
+			yahbog::movie_player player(m, *emu);
+			if (emu->state_hash() != hashes[0]) {
+				return "the player did not load the starting state";
+			}
+			while (player.run_frame()) {
+				if (emu->state_hash() != hashes[player.frame()]) {
+					return std::format("replay diverged at frame {}", player.frame());
+				}
+			}
+			if (player.frame() != c.frames || !player.finished()) {
+				return std::format("replay stopped at frame {}", player.frame());
+			}
+		}
+
+		// seeking forwards, backwards, onto keyframes and to both ends
+		{
+			yahbog::movie_player player(m, *emu);
+			const std::array<std::uint64_t, 7> targets{ c.frames / 2, 3, c.frames, 0, c.keyframe_interval, c.frames - 1, c.frames / 3 };
+			for (const auto target : targets) {
+				if (target > c.frames) {
+					continue;
+				}
+				player.seek(target);
+				if (player.frame() != target || emu->state_hash() != hashes[target]) {
+					return std::format("seeking to frame {} landed in the wrong state", target);
+				}
+			}
+
+			try {
+				player.seek(c.frames + 1);
+				return "seeking past the end did not throw";
+			}
+			catch (const std::out_of_range&) {}
+		}
+
+		// the file round trip keeps every part of the movie
+		const auto path = std::filesystem::temp_directory_path() / std::format("yahbog-movie-test-{}.ybm", c.keyframe_interval);
+		m.save(path);
+		const auto loaded = yahbog::movie::load(path);
+		std::filesystem::remove(path);
+
+		const auto same_keyframes = std::ranges::equal(m.index, loaded.index, [](const auto& a, const auto& b) {
+			return a.frame == b.frame && a.cycle == b.cycle && a.event_offset == b.event_offset && a.state_offset == b.state_offset && a.state_size == b.state_size;
+		});
+		if (loaded.rom_hash != m.rom_hash || loaded.frames != m.frames || !same_keyframes || loaded.events != m.events || loaded.states != m.states) {
+			return "the movie changed on its way through a file";
+		}
+
+		// verification passes as recorded and catches a changed input
+		const auto prototype = TestSuite::create_activity_emulator();
+		if (const auto divergences = yahbog::verify_movie(loaded, *prototype, 3); !divergences.empty()) {
+			return std::format("verification reported {} divergent segments", divergences.size());
+		}
+
+		auto tampered = loaded;
+		auto segment = tampered.index.size() / 2 - 1;
+		while (!tamper(tampered, segment)) {
+			if (++segment == tampered.index.size() - 1) {
+				return "there is no input to tamper with";
+			}
+		}
+		const auto divergences = yahbog::verify_movie(tampered, *prototype, 3);
+		if (divergences.size() != 1 || divergences[0].segment != segment) {
+			return std::format("a changed input in segment {} gave {} divergent segments", segment, divergences.size());
+		}
+		return {};
+	}
+
+	// Movies are tied to their ROM and files must be well-formed
+	std::string run_rejects() {
+		auto recorded = TestSuite::create_activity_emulator();
+		yahbog::movie_recorder recorder(*recorded, 10);
+		for (std::size_t frame = 0; frame < 15; frame++) {
+			recorder.run_frame();
+		}
+		const auto m = recorder.finish();
+
+		auto other = std::make_unique<yahbog::emulator>();
+		auto image = TestSuite::activity_rom();
+		image[0x7FFF] ^= 0xFF;
+		other->rom.load_rom(std::move(image));
+		other->reset();
+		try {
+			yahbog::movie_player player(m, *other);
+			return "a movie played on another ROM";
+		}
+		catch (const std::invalid_argument&) {}
+
+		const auto path = std::filesystem::temp_directory_path() / "yahbog-movie-test-truncated.ybm";
+		m.save(path);
+		std::filesystem::resize_file(path, std::filesystem::file_size(path) - 5);
+		try {
+			yahbog::movie::load(path);
+			std::filesystem::remove(path);
+			return "a truncated movie loaded";
+		}
+		catch (const std::invalid_argument&) {
+			std::filesystem::remove(path);
+		}
+		return {};
+	}
+
+}
+
+bool run_movie_tests() {
+	TestSuite::test_suite_runner suite("Movie Tests");
+	suite.start();
+
+	suite.print_info("🔍 Recording, replaying, seeking and verifying " + std::to_string(cases.size()) + " movies");
+	std::cout << "\n";
+
+	for (const auto& c : cases) {
+		TestSuite::run_test(suite, c.name, [&] { return run_case(c); });
+	}
+	TestSuite::run_test(suite, "rejects", run_rejects);
+
+	suite.finish();
+	return suite.passed();
+}
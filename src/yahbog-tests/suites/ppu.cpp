@@ -0,0 +1,525 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	using yahbog::gpu;
+	namespace interrupt = yahbog::interrupt;
+
+	constexpr std::size_t frames_checked = 3;
+	constexpr std::size_t dots_per_line = 456;
+
+	// A post-boot emulator; reset leaves the PPU at the first dot of a frame
+	std::unique_ptr<yahbog::emulator> make_emulator() {
+		auto emu = std::make_unique<yahbog::emulator>();
+		emu->reset();
+		return emu;
+	}
+
+	// Ticks the PPU one dot at a time for frames_checked frames and returns the
+	// dots, counted from 1, at which it requested any of the interrupts in mask
+	std::vector<std::size_t> interrupt_dots(yahbog::emulator& emu, std::uint8_t mask) {
+		std::vector<std::size_t> dots;
+		for (std::size_t dot = 1; dot <= frames_checked * gpu::dots_per_frame; dot++) {
+			if (emu.ppu.tick(1) & mask) {
+				dots.push_back(dot);
+			}
+		}
+		return dots;
+	}
+
+	// The dot at which each frame reaches line
+	std::vector<std::size_t> line_dots(std::size_t line) {
+		std::vector<std::size_t> dots;
+		for (std::size_t frame = 0; frame < frames_checked; frame++) {
+			dots.push_back(frame * gpu::dots_per_frame + line * dots_per_line);
+		}
+		return dots;
+	}
+
+	std::string compare_dots(std::string_view what, const std::vector<std::size_t>& got, const std::vector<std::size_t>& expected) {
+		if (got == expected) {
+			return {};
+		}
+		const auto [a, b] = std::ranges::mismatch(got, expected);
+		if (a == got.end()) {
+			return std::format("{} missing at dot {}", what, *b);
+		}
+		return std::format("{} requested at dot {} ({} requests, expected {})", what, *a, got.size(), expected.size());
+	}
+
+	std::string run_vblank() {
+		auto emu = make_emulator();
+		auto dots = interrupt_dots(*emu, interrupt::vblank);
+		if (auto failure = compare_dots("VBlank", dots, line_dots(144)); !failure.empty()) {
+			return failure;
+		}
+
+		// VBlank begins on the dot LY reaches 144
+		emu = make_emulator();
+		for (std::size_t dot = 1; dot < 144 * dots_per_line; dot++) {
+			emu->ppu.tick(1);
+		}
+		if (emu->mmu.read(0xFF44) != 143 || (emu->mmu.read(0xFF41) & 0b11) != 0) {
+			return "line 143 did not end in HBlank";
+		}
+		emu->ppu.tick(1);
+		if (emu->mmu.read(0xFF44) != 144 || (emu->mmu.read(0xFF41) & 0b11) != 1) {
+			return "line 144 did not start VBlank";
+		}
+		return {};
+	}
+
+	std::string run_lyc() {
+		auto emu = make_emulator();
+		emu->mmu.write(0xFF45, 42);
+		emu->mmu.write(0xFF41, 0x40);
+
+		std::vector<std::size_t> dots;
+		for (std::size_t dot = 1; dot <= frames_checked * gpu::dots_per_frame; dot++) {
+			if (emu->ppu.tick(1) & interrupt::lcd_stat) {
+				dots.push_back(dot);
+			}
+
+			const bool coincidence = emu->mmu.read(0xFF41) & 0x04;
+			if (coincidence != (emu->mmu.read(0xFF44) == 42)) {
+				return std::format("coincidence bit is {} on line {}", coincidence, emu->mmu.read(0xFF44));
+			}
+		}
+		return compare_dots("LYC", dots, line_dots(42));
+	}
+
+	std::string run_hblank() {
+		auto emu = make_emulator();
+		emu->mmu.write(0xFF41, 0x08);
+
+		std::vector<std::size_t> expected;
+		for (std::size_t frame = 0; frame < frames_checked; frame++) {
+			for (std::size_t line = 0; line < gpu::screen_height; line++) {
+				expected.push_back(frame * gpu::dots_per_frame + line * dots_per_line + 80 + 172);
+			}
+		}
+		return compare_dots("HBlank", interrupt_dots(*emu, interrupt::lcd_stat), expected);
+	}
+
+	// With the OAM and VBlank sources both enabled, the STAT line stays high from
+	// VBlank into line 0, so line 0 gets no interrupt of its own
+	std::string run_stat_blocking() {
+		auto emu = make_emulator();
+		emu->mmu.write(0xFF45, 0xFF);
+		emu->mmu.write(0xFF41, 0x30);
+
+		// the line rises on the first dot, in mode 2 of line 0, then at the start
+		// of every other visible line and at VBlank
+		std::vector<std::size_t> expected{ 1 };
+		for (std::size_t frame = 0; frame < frames_checked; frame++) {
+			for (std::size_t line = 1; line <= 144; line++) {
+				expected.push_back(frame * gpu::dots_per_frame + line * dots_per_line);
+			}
+		}
+		return compare_dots("STAT", interrupt_dots(*emu, interrupt::lcd_stat), expected);
+	}
+
+	std::string run_lcd_off() {
+		auto emu = make_emulator();
+		for (std::size_t dot = 0; dot < 50 * dots_per_line + 100; dot++) {
+			emu->ppu.tick(1);
+		}
+
+		emu->mmu.write(0xFF40, 0x11);
+		if (emu->mmu.read(0xFF44) != 0 || (emu->mmu.read(0xFF41) & 0b11) != 0) {
+			return "turning the LCD off did not reset LY and the mode";
+		}
+		for (std::size_t dot = 0; dot < gpu::dots_per_frame; dot++) {
+			if (emu->ppu.tick(1)) {
+				return "an interrupt was requested with the LCD off";
+			}
+		}
+
+		// LY is read-only
+		emu->mmu.write(0xFF44, 0x90);
+		if (emu->mmu.read(0xFF44) != 0) {
+			return "LY was written";
+		}
+
+		// turning it back on starts a frame from line 0
+		emu->mmu.write(0xFF40, 0x91);
+		return compare_dots("VBlank", interrupt_dots(*emu, interrupt::vblank), line_dots(144));
+	}
+
+	// emulator::run_frame drives the CPU and PPU together and raises IF
+	std::string run_loop() {
+		std::vector<std::uint8_t> rom(0x8000);
+		// di; jr -2
+		rom[0x100] = 0xF3;
+		rom[0x101] = 0x18;
+		rom[0x102] = 0xFE;
+
+		yahbog::emulator emu;
+		emu.rom.load_rom(std::move(rom));
+		emu.reset();
+		emu.mmu.write(0xFF0F, 0x00);
+		emu.mmu.write(0xFF45, 10);
+		emu.mmu.write(0xFF41, 0x40);
+
+		const auto first = emu.run_frame();
+		if (first != 144 * dots_per_line / 4) {
+			return std::format("the first frame took {} cycles", first);
+		}
+		if ((emu.mmu.read(0xFF0F) & 0x1F) != (interrupt::vblank | interrupt::lcd_stat)) {
+			return std::format("IF is {:02X} after the first frame", emu.mmu.read(0xFF0F));
+		}
+
+		emu.mmu.write(0xFF0F, 0x00);
+		const auto second = emu.run_frame();
+		if (second != yahbog::emulator::cycles_per_frame) {
+			return std::format("the second frame took {} cycles", second);
+		}
+		if ((emu.mmu.read(0xFF0F) & 0x1F) != (interrupt::vblank | interrupt::lcd_stat)) {
+			return std::format("IF is {:02X} after the second frame", emu.mmu.read(0xFF0F));
+		}
+		return {};
+	}
+
+	// Solid 8x8 tiles: 1 in colour 3, 2 in colour 1, 3 with its left half transparent
+	std::unique_ptr<yahbog::emulator> make_sprite_emulator() {
+		auto emu = make_emulator();
+		for (std::uint16_t row = 0; row < 8; row++) {
+			emu->mmu.write(0x8010 + row * 2, 0xFF);
+			emu->mmu.write(0x8011 + row * 2, 0xFF);
+			emu->mmu.write(0x8020 + row * 2, 0xFF);
+			emu->mmu.write(0x8030 + row * 2, 0x0F);
+			emu->mmu.write(0x8031 + row * 2, 0x0F);
+		}
+		emu->mmu.write(0xFF47, 0xE4);
+		emu->mmu.write(0xFF48, 0xE4);
+		emu->mmu.write(0xFF40, 0x93);
+		return emu;
+	}
+
+	void set_sprite(yahbog::emulator& emu, std::uint16_t index, int x, int y, std::uint8_t tile) {
+		const std::uint16_t base = 0xFE00 + index * 4;
+		emu.mmu.write(base, static_cast<std::uint8_t>(y + 16));
+		emu.mmu.write(base + 1, static_cast<std::uint8_t>(x + 8));
+		emu.mmu.write(base + 2, tile);
+		emu.mmu.write(base + 3, 0x00);
+	}
+
+	// Runs from the start of a frame to the start of the next
+	void draw_frame(yahbog::emulator& emu) {
+		for (std::size_t dot = 0; dot < gpu::dots_per_frame; dot += 4) {
+			emu.ppu.tick(4);
+		}
+	}
+
+	std::uint8_t shade(const yahbog::emulator& emu, std::size_t x, std::size_t y) {
+		const auto i = y * gpu::screen_width + x;
+		return (emu.ppu.framebuffer()[i / 4] >> (6 - (i % 4) * 2)) & 0b11;
+	}
+
+	// Checks the shades of the pixels from x to x + width on line y
+	std::string expect_shades(const yahbog::emulator& emu, std::size_t x, std::size_t y, std::size_t width, std::uint8_t expected) {
+		for (std::size_t i = x; i < x + width; i++) {
+			if (shade(emu, i, y) != expected) {
+				return std::format("pixel {},{} has shade {}, expected {}", i, y, shade(emu, i, y), expected);
+			}
+		}
+		return {};
+	}
+
+	// Only the first ten sprites in OAM order that overlap a line are drawn,
+	// even when later ones are further left
+	std::string run_sprite_limit() {
+		auto emu = make_sprite_emulator();
+		for (std::uint16_t i = 0; i < 10; i++) {
+			set_sprite(*emu, i, 40 + i * 10, 20, 1);
+		}
+		set_sprite(*emu, 10, 0, 20, 1);
+		set_sprite(*emu, 11, 10, 20, 1);
+		// the limit is per line
+		set_sprite(*emu, 12, 0, 40, 1);
+		draw_frame(*emu);
+
+		for (std::size_t i = 0; i < 10; i++) {
+			if (auto failure = expect_shades(*emu, 40 + i * 10, 20, 8, 3); !failure.empty()) {
+				return failure;
+			}
+		}
+		if (auto failure = expect_shades(*emu, 0, 20, 18, 0); !failure.empty()) {
+			return failure;
+		}
+		return expect_shades(*emu, 0, 40, 8, 3);
+	}
+
+	// Where sprites overlap, the lower X wins and then the lower OAM index; a
+	// transparent pixel lets the next sprite through
+	std::string run_sprite_priority() {
+		auto emu = make_sprite_emulator();
+		set_sprite(*emu, 0, 20, 60, 1);
+		set_sprite(*emu, 1, 16, 60, 2);
+		set_sprite(*emu, 2, 60, 80, 1);
+		set_sprite(*emu, 3, 60, 80, 2);
+		set_sprite(*emu, 4, 100, 100, 3);
+		set_sprite(*emu, 5, 102, 100, 2);
+		draw_frame(*emu);
+
+		for (const auto& [x, y, width, expected] : std::initializer_list<std::tuple<std::size_t, std::size_t, std::size_t, std::uint8_t>>{
+			{ 16, 60, 8, 1 }, { 24, 60, 4, 3 },
+			{ 60, 80, 8, 3 },
+			{ 102, 100, 2, 1 }, { 104, 100, 4, 3 }, { 108, 100, 2, 1 } }) {
+			if (auto failure = expect_shades(*emu, x, y, width, expected); !failure.empty()) {
+				return failure;
+			}
+		}
+		return {};
+	}
+
+	// Moving a sprite or changing the sprite height takes effect on the next frame
+	std::string run_sprite_changes() {
+		auto emu = make_sprite_emulator();
+		set_sprite(*emu, 0, 30, 20, 1);
+		draw_frame(*emu);
+		if (auto failure = expect_shades(*emu, 30, 20, 8, 3); !failure.empty()) {
+			return failure;
+		}
+
+		set_sprite(*emu, 0, 30, 50, 1);
+		draw_frame(*emu);
+		if (auto failure = expect_shades(*emu, 30, 20, 8, 0); !failure.empty()) {
+			return failure;
+		}
+		if (auto failure = expect_shades(*emu, 30, 57, 8, 3); !failure.empty()) {
+			return failure;
+		}
+		if (auto failure = expect_shades(*emu, 30, 58, 8, 0); !failure.empty()) {
+			return failure;
+		}
+
+		// 8x16 sprites use tile & 0xFE on top of tile | 1, which is tile 1
+		emu->mmu.write(0xFF40, 0x97);
+		draw_frame(*emu);
+		if (auto failure = expect_shades(*emu, 30, 50, 8, 0); !failure.empty()) {
+			return failure;
+		}
+		return expect_shades(*emu, 30, 65, 8, 3);
+	}
+
+	// What write_line should make of a line of shades in format
+	std::vector<std::uint8_t> convert_line(std::span<const std::uint8_t> shades, yahbog::pixel_format format, const yahbog::output_palette& palette) {
+		std::vector<std::uint8_t> out;
+		for (std::size_t x = 0; x < shades.size(); x++) {
+			const auto& c = palette.colors[shades[x]];
+			switch (format) {
+			case yahbog::pixel_format::packed_2bpp:
+				if (x % 4 == 0) {
+					out.push_back(0);
+				}
+				out.back() |= static_cast<std::uint8_t>(shades[x] << (6 - (x % 4) * 2));
+				break;
+			case yahbog::pixel_format::indexed8:
+				out.push_back(palette.indices[shades[x]]);
+				break;
+			case yahbog::pixel_format::rgba8888:
+				out.insert(out.end(), { c.r, c.g, c.b, c.a });
+				break;
+			case yahbog::pixel_format::bgra8888:
+				out.insert(out.end(), { c.b, c.g, c.r, c.a });
+				break;
+			}
+		}
+		return out;
+	}
+
+	struct output_target {
+		yahbog::pixel_format format;
+		bool double_buffered;
+		// draw through a ppu_worker, which inherits the output
+		bool worker;
+	};
+
+	// Every format, single and double buffered, with a padded stride and a custom
+	// palette, against the packed framebuffer of an emulator without an output
+	std::string run_output_formats() {
+		using enum yahbog::pixel_format;
+		constexpr std::array targets{
+			output_target{ packed_2bpp, true,  false },
+			output_target{ indexed8,    true,  false },
+			output_target{ rgba8888,    true,  false },
+			output_target{ bgra8888,    true,  false },
+			output_target{ packed_2bpp, false, false },
+			output_target{ indexed8,    false, false },
+			output_target{ rgba8888,    false, false },
+			output_target{ bgra8888,    false, false },
+			output_target{ rgba8888,    true,  true },
+			output_target{ indexed8,    false, true },
+		};
+
+		yahbog::output_palette palette;
+		palette.colors = { {
+			{ 0x10, 0x20, 0x30, 0x40 },
+			{ 0x50, 0x60, 0x70, 0x80 },
+			{ 0x90, 0xA0, 0xB0, 0xC0 },
+			{ 0xD0, 0xE0, 0xF0, 0xFF }
+		} };
+		palette.indices = { 9, 3, 200, 77 };
+
+		struct output_run {
+			output_target target;
+			std::unique_ptr<yahbog::emulator> emu;
+			std::array<std::vector<std::uint8_t>, 2> buffers;
+			std::size_t stride;
+			std::unique_ptr<yahbog::ppu_worker> worker;
+			const std::uint8_t* last_front = nullptr;
+		};
+
+		auto reference = TestSuite::create_activity_emulator();
+		std::vector<output_run> runs(targets.size());
+		for (std::size_t i = 0; i < targets.size(); i++) {
+			auto& run = runs[i];
+			run.target = targets[i];
+			run.emu = TestSuite::create_activity_emulator();
+			run.stride = yahbog::bytes_per_pixel_line(run.target.format, gpu::screen_width) + 12;
+
+			yahbog::frame_output output{ .format = run.target.format, .palette = palette, .stride = run.stride };
+			for (std::size_t b = 0; b < (run.target.double_buffered ? 2 : 1); b++) {
+				run.buffers[b].resize(run.stride * gpu::screen_height);
+				output.buffers[b] = run.buffers[b];
+			}
+			run.emu->ppu.set_output(output);
+
+			if (run.target.worker) {
+				run.worker = std::make_unique<yahbog::ppu_worker>(run.emu->ppu);
+			}
+		}
+
+		std::size_t frames_drawn = reference->ppu.frames();
+		for (std::size_t frame = 0; frame < 60; frame++) {
+			reference->run_frame();
+			for (auto& run : runs) {
+				run.emu->run_frame();
+				if (run.worker) {
+					run.worker->sync();
+				}
+			}
+
+			if (reference->ppu.frames() == frames_drawn) {
+				continue;
+			}
+			frames_drawn = reference->ppu.frames();
+
+			std::array<std::uint8_t, gpu::screen_width> shades{};
+			for (std::size_t i = 0; i < runs.size(); i++) {
+				auto& run = runs[i];
+				const auto front = run.emu->ppu.front_buffer();
+				if (run.target.double_buffered && front.data() == run.last_front) {
+					return std::format("output {} did not swap its buffers at frame {}", i, frame);
+				}
+				run.last_front = front.data();
+
+				for (std::size_t y = 0; y < gpu::screen_height; y++) {
+					for (std::size_t x = 0; x < gpu::screen_width; x++) {
+						shades[x] = shade(*reference, x, y);
+					}
+
+					const auto expected = convert_line(shades, run.target.format, palette);
+					if (!std::ranges::equal(front.subspan(y * run.stride, expected.size()), expected)) {
+						return std::format("output {} differs from the framebuffer on line {} of frame {}", i, y, frame);
+					}
+				}
+			}
+		}
+		return {};
+	}
+
+	// Buffers that cannot hold a frame are refused
+	std::string run_output_rejects() {
+		auto emu = make_emulator();
+		std::vector<std::uint8_t> buffer(gpu::screen_width * gpu::screen_height * 4);
+
+		const std::array<yahbog::frame_output, 3> bad_outputs{ {
+			{ .format = yahbog::pixel_format::rgba8888, .buffers = { std::span{ buffer }.first(buffer.size() - 1) } },
+			{ .format = yahbog::pixel_format::indexed8, .buffers = { buffer }, .stride = gpu::screen_width - 1 },
+			{ .format = yahbog::pixel_format::rgba8888, .buffers = { buffer, std::span{ buffer }.first(100) } },
+		} };
+		for (const auto& output : bad_outputs) {
+			try {
+				emu->ppu.set_output(output);
+				return std::format("an output in format {} was accepted", static_cast<int>(output.format));
+			}
+			catch (const std::invalid_argument&) {}
+		}
+		return emu->ppu.has_output() ? "a refused output was registered" : "";
+	}
+
+	// The incremental hash equals hashing the finished framebuffer, with or
+	// without an output, and stops changing while hashing is off
+	std::string run_frame_hash() {
+		auto emu = TestSuite::create_activity_emulator();
+		auto with_output = TestSuite::create_activity_emulator();
+		std::vector<std::uint8_t> buffer(gpu::screen_width * gpu::screen_height * 4);
+		with_output->ppu.set_output({ .format = yahbog::pixel_format::rgba8888, .buffers = { buffer } });
+
+		std::size_t frames_drawn = emu->ppu.frames();
+		std::set<std::uint64_t> distinct_hashes;
+		for (std::size_t frame = 0; frame < 60; frame++) {
+			emu->run_frame();
+			with_output->run_frame();
+			if (emu->ppu.frames() == frames_drawn) {
+				continue;
+			}
+			frames_drawn = emu->ppu.frames();
+
+			const auto hash = yahbog::xxhash64_of(emu->ppu.framebuffer());
+			if (emu->ppu.frame_hash() != hash) {
+				return std::format("frame_hash() is {:016X} at frame {}, the framebuffer hashes to {:016X}", emu->ppu.frame_hash(), frame, hash);
+			}
+			if (with_output->ppu.frame_hash() != hash) {
+				return std::format("frame_hash() with an output differs at frame {}", frame);
+			}
+			distinct_hashes.insert(hash);
+		}
+		if (distinct_hashes.size() < 20) {
+			return std::format("only {} distinct frames were drawn", distinct_hashes.size());
+		}
+
+		const auto last = emu->ppu.frame_hash();
+		emu->ppu.set_frame_hashing(false);
+		for (std::size_t frame = 0; frame < 5; frame++) {
+			emu->run_frame();
+		}
+		if (emu->ppu.frame_hash() != last) {
+			return "the hash changed with hashing off";
+		}
+		return {};
+	}
+
+	constexpr std::array<std::pair<std::string_view, std::string(*)()>, 12> cases{ {
+		{ "VBlank",          run_vblank },
+		{ "LYC",             run_lyc },
+		{ "HBlank",          run_hblank },
+		{ "STAT blocking",   run_stat_blocking },
+		{ "LCD off",         run_lcd_off },
+		{ "run loop",        run_loop },
+		{ "sprite limit",    run_sprite_limit },
+		{ "sprite priority", run_sprite_priority },
+		{ "sprite changes",  run_sprite_changes },
+		{ "output formats",  run_output_formats },
+		{ "output rejects",  run_output_rejects },
+		{ "frame hash",      run_frame_hash },
+	} };
+
+}
+
+bool run_ppu_tests() {
+	TestSuite::test_suite_runner suite("PPU Tests");
+	suite.start();
+
+	suite.print_info("🔍 Checking the PPU in " + std::to_string(cases.size()) + " cases");
+	std::cout << "\n";
+
+	for (const auto& [name, run] : cases) {
+		TestSuite::run_test(suite, name, run);
+	}
+
+	suite.finish();
+	return suite.passed();
+}
@@ -0,0 +1,119 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	constexpr auto never = (std::numeric_limits<std::size_t>::max)();
+
+	struct worker_case {
+		std::string_view name;
+
+		std::size_t frames;
+		// frame before which the worker takes over rasterization
+		std::size_t attach_at;
+		// frame halfway through which the worker is destroyed
+		std::size_t detach_at;
+		// poke the scroll, palette, window and LCDC registers and VRAM through
+		// the bus every few hundred cycles, on top of what the ROM does at VBlank
+		bool mid_frame_writes;
+	};
+
+	constexpr std::array cases{
+		worker_case{ "from the start",      120, 0,  never, false },
+		worker_case{ "attached mid-run",    120, 50, never, false },
+		worker_case{ "mid-frame writes",    120, 0,  never, true },
+		worker_case{ "mid-frame, attached", 120, 50, never, true },
+		worker_case{ "detached mid-frame",  120, 0,  60,    false },
+		worker_case{ "mid-frame, detached", 120, 0,  60,    true },
+	};
+
+	void run_frame(yahbog::emulator& emu, std::size_t frame, bool mid_frame_writes) {
+		if (!mid_frame_writes) {
+			emu.run_frame();
+			return;
+		}
+
+		const auto target = emu.ppu.frames() + 1;
+		for (std::size_t chunk = 0; emu.ppu.frames() < target; chunk++) {
+			emu.run_cycles(317);
+
+			const auto value = static_cast<std::uint8_t>(frame * 7 + chunk * 13);
+			emu.writer(0xFF43, value);                      // SCX
+			emu.writer(0xFF47, value ^ 0xE4);               // BGP
+			emu.writer(0xFF4A, value & 0x7F);               // WY
+			emu.writer(0xFF4B, 7 + (value & 0x7F));         // WX
+			emu.writer(0x9C00 + value * 3, value);          // window map
+			emu.writer(0xFF40, (chunk & 4) ? 0xF3 : 0x93);  // window on and off
+		}
+	}
+
+	// Runs the same ROM with inline rendering and with a ppu_worker, checking
+	// the framebuffer, frame hash and what the CPU sees of the machine after
+	// every frame
+	std::string run_case(const worker_case& c) {
+		auto inline_emu = TestSuite::create_activity_emulator();
+		auto threaded_emu = TestSuite::create_activity_emulator();
+		std::unique_ptr<yahbog::ppu_worker> worker;
+		std::set<std::uint64_t> distinct_frames;
+		std::size_t frames_drawn = inline_emu->ppu.frames();
+
+		for (std::size_t frame = 0; frame < c.frames; frame++) {
+			if (frame == c.attach_at) {
+				worker = std::make_unique<yahbog::ppu_worker>(threaded_emu->ppu);
+			}
+
+			// the lines the worker drew before it went away are kept
+			if (frame == c.detach_at) {
+				inline_emu->run_cycles(yahbog::emulator::cycles_per_frame / 2);
+				threaded_emu->run_cycles(yahbog::emulator::cycles_per_frame / 2);
+				worker.reset();
+			}
+
+			run_frame(*inline_emu, frame, c.mid_frame_writes);
+			run_frame(*threaded_emu, frame, c.mid_frame_writes);
+
+			if (worker) {
+				worker->sync();
+			}
+
+			if (inline_emu->state_hash() != threaded_emu->state_hash()) {
+				return std::format("emulated state diverged at frame {}", frame);
+			}
+
+			// inline rendering fills the framebuffer line by line, so the two only
+			// agree once a frame is complete, which it is not while the LCD is off
+			if (inline_emu->ppu.frames() == frames_drawn) {
+				continue;
+			}
+			frames_drawn = inline_emu->ppu.frames();
+
+			if (inline_emu->ppu.framebuffer() != threaded_emu->ppu.framebuffer()) {
+				return std::format("framebuffers differ at frame {}", frame);
+			}
+			if (inline_emu->ppu.frame_hash() != threaded_emu->ppu.frame_hash()) {
+				return std::format("frame hashes differ at frame {}", frame);
+			}
+			distinct_frames.insert(inline_emu->ppu.frame_hash());
+		}
+
+		if (distinct_frames.size() < c.frames / 2) {
+			return std::format("only {} distinct frames were drawn", distinct_frames.size());
+		}
+		return {};
+	}
+
+}
+
+bool run_ppu_worker_tests() {
+	TestSuite::test_suite_runner suite("PPU Worker Tests");
+	suite.start();
+
+	suite.print_info("🔍 Comparing inline rendering against a ppu_worker in " + std::to_string(cases.size()) + " runs");
+	std::cout << "\n";
+
+	for (const auto& c : cases) {
+		TestSuite::run_test(suite, c.name, [&] { return run_case(c); });
+	}
+
+	suite.finish();
+	return suite.passed();
+}
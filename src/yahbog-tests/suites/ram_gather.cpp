@@ -0,0 +1,195 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	using memory_dispatcher = decltype(yahbog::emulator::mmu);
+
+	// What the bus holds at addr, with open bus as 0xFF
+	std::uint8_t bus_read(yahbog::emulator& emu, std::uint16_t addr) {
+		return memory_dispatcher::handles(addr) ? emu.mmu.read(addr) : 0xFF;
+	}
+
+	void bus_write(yahbog::emulator& emu, std::uint16_t addr, std::uint8_t value) {
+		if (memory_dispatcher::handles(addr)) {
+			emu.mmu.write(addr, value);
+		}
+	}
+
+	std::unique_ptr<yahbog::emulator> make_emulator() {
+		auto emu = TestSuite::create_activity_emulator();
+		for (std::size_t frame = 0; frame < 30; frame++) {
+			emu->run_frame();
+		}
+		return emu;
+	}
+
+	// Spans across the edges of every region and through both holes
+	constexpr std::array<yahbog::ram_range, 9> spans{ {
+		{ 0x7FF0, 0x20 },
+		{ 0x9FF0, 0x20 },
+		{ 0xBFF0, 0x20 },
+		{ 0xDFF0, 0x30 },
+		{ 0xFDF0, 0x120 },
+		{ 0xFF40, 0x50 },
+		{ 0xFF70, 0x90 },
+		{ 0xE000, 0x10 },
+		{ 0x0000, 0x8000 },
+	} };
+
+	// Reading spans matches reading the bus a byte at a time, holes included
+	std::string run_peek() {
+		if (memory_dispatcher::handles(0xFEA0) || memory_dispatcher::handles(0xFF4C)) {
+			return "0xFEA0 or 0xFF4C is no longer open bus";
+		}
+
+		auto emu = make_emulator();
+		std::vector<std::uint8_t> whole(0x10000);
+		emu->peek_span(0, whole);
+		for (std::size_t a = 0; a < whole.size(); a++) {
+			if (whole[a] != bus_read(*emu, static_cast<std::uint16_t>(a))) {
+				return std::format("{:04X} peeks as {:02X}, but reads as {:02X}", a, whole[a], bus_read(*emu, static_cast<std::uint16_t>(a)));
+			}
+		}
+
+		for (const auto& span : spans) {
+			std::vector<std::uint8_t> out(span.length);
+			emu->peek_span(span.start, out);
+			for (std::size_t i = 0; i < out.size(); i++) {
+				const auto a = static_cast<std::uint16_t>(span.start + i);
+				if (out[i] != bus_read(*emu, a)) {
+					return std::format("{:04X} peeks as {:02X} from {:04X}, but reads as {:02X}", a, out[i], span.start, bus_read(*emu, a));
+				}
+			}
+		}
+
+		try {
+			std::vector<std::uint8_t> out(17);
+			emu->peek_span(0xFFF0, out);
+			return "a span past FFFF was peeked";
+		}
+		catch (const std::out_of_range&) {}
+		return {};
+	}
+
+	// Writing spans leaves the machine as writing the bus a byte at a time,
+	// with writes to holes dropped
+	std::string run_poke() {
+		auto spanned = make_emulator();
+		auto serial = spanned->clone();
+
+		constexpr std::array<yahbog::ram_range, 7> writes{ {
+			{ 0xC000, 0x2000 },
+			{ 0xE010, 0x10 },
+			{ 0xFF80, 0x7F },
+			{ 0x8000, 0x100 },
+			{ 0xFE80, 0x40 },
+			{ 0xFF4A, 0x40 },
+			{ 0x9FF0, 0x20 },
+		} };
+
+		std::uint8_t value = 0;
+		for (const auto& w : writes) {
+			std::vector<std::uint8_t> in(w.length);
+			for (auto& b : in) {
+				b = value += 37;
+			}
+			spanned->poke_span(w.start, in);
+			for (std::size_t i = 0; i < in.size(); i++) {
+				bus_write(*serial, static_cast<std::uint16_t>(w.start + i), in[i]);
+			}
+
+			if (spanned->state_hash() != serial->state_hash()) {
+				return std::format("poking {:04X}+{} differs from writing it per byte", w.start, w.length);
+			}
+		}
+
+		try {
+			std::vector<std::uint8_t> in(2);
+			spanned->poke_span(0xFFFF, in);
+			return "a span past FFFF was poked";
+		}
+		catch (const std::out_of_range&) {}
+		return {};
+	}
+
+	// Gathered ranges match reading each of them a byte at a time, including
+	// registers, holes, echo RAM and disabled external RAM, and merged neighbours
+	std::string run_gather() {
+		const std::vector<yahbog::ram_range> ranges{
+			{ 0xFF00, 128 },
+			{ 0xC000, 0x2000 },
+			{ 0xC010, 8 },
+			{ 0xC018, 8 },
+			{ 0xFE90, 0x20 },
+			{ 0xE000, 16 },
+			{ 0x8000, 16 },
+			{ 0xFFFF, 1 },
+			{ 0x0100, 4 },
+			{ 0xA000, 4 },
+			{ 0xFF4C, 0xB4 },
+		};
+		const yahbog::ram_gather gather(ranges);
+
+		std::size_t size = 0;
+		for (const auto& r : ranges) {
+			size += r.length;
+		}
+		if (gather.size() != size) {
+			return std::format("{} bytes are gathered, expected {}", gather.size(), size);
+		}
+
+		auto emu = make_emulator();
+		for (std::size_t frame = 0; frame < 3; frame++) {
+			emu->run_frame();
+
+			std::vector<std::uint8_t> out(gather.size());
+			gather.gather(*emu, out);
+
+			std::size_t i = 0;
+			for (const auto& r : ranges) {
+				for (std::size_t a = r.start; a < r.start + std::size_t{ r.length }; a++, i++) {
+					if (out[i] != bus_read(*emu, static_cast<std::uint16_t>(a))) {
+						return std::format("{:04X} gathers as {:02X}, but reads as {:02X}", a, out[i], bus_read(*emu, static_cast<std::uint16_t>(a)));
+					}
+				}
+			}
+		}
+
+		try {
+			std::vector<std::uint8_t> out(gather.size() - 1);
+			gather.gather(*emu, out);
+			return "a short buffer was gathered into";
+		}
+		catch (const std::invalid_argument&) {}
+
+		try {
+			const std::array<yahbog::ram_range, 1> past{ { { 0xFFF0, 17 } } };
+			yahbog::ram_gather bad(past);
+			return "a range past FFFF was accepted";
+		}
+		catch (const std::invalid_argument&) {}
+		return {};
+	}
+
+	constexpr std::array<std::pair<std::string_view, std::string(*)()>, 3> cases{ {
+		{ "peek_span",  run_peek },
+		{ "poke_span",  run_poke },
+		{ "ram_gather", run_gather },
+	} };
+
+}
+
+bool run_ram_gather_tests() {
+	TestSuite::test_suite_runner suite("RAM Gather Tests");
+	suite.start();
+
+	suite.print_info("🔍 Checking span access against the bus in " + std::to_string(cases.size()) + " cases");
+	std::cout << "\n";
+
+	for (const auto& [name, run] : cases) {
+		TestSuite::run_test(suite, name, run);
+	}
+
+	suite.finish();
+	return suite.passed();
+}
@@ -0,0 +1,151 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	struct rate_case {
+		std::string_view name;
+		std::uint32_t output_rate;
+		std::uint32_t input_rate;
+	};
+
+	// the common host rates, upsampling and a rate with no small ratio
+	constexpr std::array cases{
+		rate_case{ "48000 Hz",          48000, yahbog::apu::sample_rate },
+		rate_case{ "44100 Hz",          44100, yahbog::apu::sample_rate },
+		rate_case{ "22050 Hz",          22050, yahbog::apu::sample_rate },
+		rate_case{ "upsampled",         96000, 32768 },
+		rate_case{ "44100 from 47999",  44100, 47999 },
+	};
+
+	constexpr std::array levels{ yahbog::simd::level::scalar, yahbog::simd::level::sse2, yahbog::simd::level::avx2 };
+
+	// What the activity ROM plays, then full-scale random frames to exercise
+	// clamping
+	std::vector<std::int16_t> make_input() {
+		std::vector<std::int16_t> input;
+		auto emu = TestSuite::create_activity_emulator();
+		for (std::size_t i = 0; i < 30; i++) {
+			emu->run_frame();
+			std::vector<std::int16_t> chunk(emu->spu.samples_available() * 2);
+			const auto frames = emu->spu.read_samples(chunk);
+			input.insert(input.end(), chunk.begin(), chunk.begin() + frames * 2);
+		}
+
+		std::uint32_t seed = 0x9E3779B9;
+		for (std::size_t i = 0; i < 20000; i++) {
+			seed = seed * 1664525 + 1013904223;
+			input.push_back(static_cast<std::int16_t>(seed >> 16));
+		}
+		return input;
+	}
+
+	// Pushes and pulls the same chunks through a resampler per SIMD level and
+	// checks that every level writes the same samples as scalar
+	template<typename T>
+	std::string run_format(const rate_case& c, const std::vector<std::int16_t>& input) {
+		std::vector<yahbog::resampler> resamplers;
+		for (const auto level : levels) {
+			if (level <= yahbog::simd::best()) {
+				resamplers.emplace_back(c.output_rate, c.input_rate, level);
+			}
+		}
+
+		auto& scalar = resamplers.front();
+		if (scalar.level() != yahbog::simd::level::scalar) {
+			return "the scalar resampler runs at another level";
+		}
+
+		std::vector<std::vector<T>> outputs(resamplers.size());
+		std::size_t offset = 0;
+		for (std::size_t i = 0; offset < input.size(); i++) {
+			// odd-sized pushes and pulls that sometimes leave frames behind
+			const auto push = (std::min)(input.size() - offset, (i * 733 % 4001 + 1) * 2);
+			const auto pull = i * 389 % 2003 + 1;
+			for (std::size_t r = 0; r < resamplers.size(); r++) {
+				resamplers[r].push(std::span<const std::int16_t>(input.data() + offset, push));
+
+				std::vector<T> chunk(pull * 2);
+				const auto frames = resamplers[r].pull(std::span<T>(chunk));
+				outputs[r].insert(outputs[r].end(), chunk.begin(), chunk.begin() + frames * 2);
+			}
+			offset += push;
+		}
+		for (std::size_t r = 0; r < resamplers.size(); r++) {
+			std::vector<T> rest(resamplers[r].frames_available() * 2);
+			resamplers[r].pull(std::span<T>(rest));
+			outputs[r].insert(outputs[r].end(), rest.begin(), rest.end());
+		}
+
+		const auto expected = static_cast<double>(input.size() / 2) * c.output_rate / c.input_rate;
+		if (static_cast<double>(outputs.front().size() / 2) < expected * 0.9) {
+			return std::format("only {} frames were pulled, expected about {}", outputs.front().size() / 2, expected);
+		}
+		for (std::size_t r = 1; r < resamplers.size(); r++) {
+			if (outputs[r] != outputs.front()) {
+				const auto [a, b] = std::ranges::mismatch(outputs[r], outputs.front());
+				return std::format("level {} differs from scalar at sample {}",
+					static_cast<int>(resamplers[r].level()), a - outputs[r].begin());
+			}
+		}
+		return {};
+	}
+
+	std::string run_case(const rate_case& c, const std::vector<std::int16_t>& input) {
+		if (auto failure = run_format<std::int16_t>(c, input); !failure.empty()) {
+			return "int16: " + failure;
+		}
+		if (auto failure = run_format<float>(c, input); !failure.empty()) {
+			return "float: " + failure;
+		}
+		return {};
+	}
+
+	// A constant signal comes out unchanged, since every phase has unity gain
+	std::string run_dc() {
+		yahbog::resampler r(44100);
+		const std::vector<std::int16_t> input(8192 * 2, 12345);
+		r.push(input);
+
+		std::vector<std::int16_t> out(r.frames_available() * 2);
+		r.pull(std::span<std::int16_t>(out));
+		for (std::size_t i = 0; i < out.size(); i++) {
+			if (out[i] != 12345) {
+				return std::format("sample {} is {}, expected 12345", i, out[i]);
+			}
+		}
+		return {};
+	}
+
+	// Zero rates are refused
+	std::string run_rejects() {
+		for (const auto& [output_rate, input_rate] : { std::pair{ 0u, 48000u }, std::pair{ 48000u, 0u } }) {
+			try {
+				yahbog::resampler r(output_rate, input_rate);
+				return std::format("{} -> {} was accepted", input_rate, output_rate);
+			}
+			catch (const std::invalid_argument&) {}
+		}
+		return {};
+	}
+
+}
+
+bool run_resampler_tests() {
+	TestSuite::test_suite_runner suite("Resampler Tests");
+	suite.start();
+
+	constexpr std::array level_names{ "scalar", "SSE2", "AVX2" };
+	suite.print_info("🔍 Comparing " + std::string(level_names[static_cast<std::size_t>(yahbog::simd::best())]) +
+		" and lower levels against scalar at " + std::to_string(cases.size()) + " rates");
+	std::cout << "\n";
+
+	const auto input = make_input();
+	for (const auto& c : cases) {
+		TestSuite::run_test(suite, c.name, [&] { return run_case(c, input); });
+	}
+	TestSuite::run_test(suite, "DC gain", run_dc);
+	TestSuite::run_test(suite, "rejects", run_rejects);
+
+	suite.finish();
+	return suite.passed();
+}
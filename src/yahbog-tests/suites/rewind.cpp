@@ -0,0 +1,93 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	struct rewind_case {
+		std::string_view name;
+
+		std::size_t budget;
+		std::size_t keyframe_interval;
+		std::size_t frames;
+
+		// step back this many snapshots after every push_run pushes, to mix
+		// rewinding into recording; play resumes from the last restored state
+		std::size_t push_run;
+		std::size_t step_back;
+	};
+
+	// Small budgets against a few hundred frames, so the ring wraps many times
+	// over records whose sizes vary with the buttons and the sound channels
+	constexpr std::array cases{
+		rewind_case{ "keyframes only",     96 * 1024,  1, 300, 0,  0 },
+		rewind_case{ "short groups",       96 * 1024,  4, 400, 0,  0 },
+		rewind_case{ "long groups",        128 * 1024, 30, 600, 0, 0 },
+		rewind_case{ "interleaved rewind", 96 * 1024,  6, 500, 17, 5 },
+	};
+
+	// Pushes a snapshot per frame while keeping the same states on the side,
+	// then walks the buffer back and checks every restored state against them
+	std::string run_case(const rewind_case& c) {
+		auto emu = TestSuite::create_activity_emulator();
+		yahbog::rewind_buffer buffer(c.budget, c.keyframe_interval);
+
+		std::vector<std::vector<std::byte>> reference;
+		std::size_t evicted = 0;
+		std::uint32_t seed = 0x2545F491;
+
+		for (std::size_t frame = 0; frame < c.frames; frame++) {
+			seed = seed * 1664525 + 1013904223;
+			emu->set_buttons(static_cast<std::uint8_t>(seed >> 24));
+			emu->run_frame();
+
+			reference.push_back(TestSuite::save(*emu));
+			if (!buffer.push(*emu)) {
+				return std::format("push failed at frame {}", frame);
+			}
+
+			// whatever the buffer dropped is the oldest part of the reference
+			evicted = reference.size() - buffer.size();
+
+			if (c.push_run && frame % c.push_run == c.push_run - 1) {
+				for (std::size_t i = 0; i < c.step_back && buffer.size() > 1; i++) {
+					if (!buffer.rewind(*emu) || TestSuite::save(*emu) != reference.back()) {
+						return std::format("stepping back at frame {} restored the wrong state", frame);
+					}
+					reference.pop_back();
+				}
+			}
+		}
+
+		if (evicted == 0) {
+			return "the budget never filled up";
+		}
+
+		std::size_t restored = 0;
+		while (buffer.rewind(*emu)) {
+			if (TestSuite::save(*emu) != reference[reference.size() - 1 - restored]) {
+				return std::format("snapshot {} back from the newest did not match", restored);
+			}
+			restored++;
+		}
+
+		if (restored != reference.size() - evicted) {
+			return std::format("restored {} snapshots, expected {}", restored, reference.size() - evicted);
+		}
+		return {};
+	}
+
+}
+
+bool run_rewind_tests() {
+	TestSuite::test_suite_runner suite("Rewind Tests");
+	suite.start();
+
+	suite.print_info("🔍 Recording and stepping back through " + std::to_string(cases.size()) + " rewind buffers");
+	std::cout << "\n";
+
+	for (const auto& c : cases) {
+		TestSuite::run_test(suite, c.name, [&] { return run_case(c); });
+	}
+
+	suite.finish();
+	return suite.passed();
+}
@@ -0,0 +1,173 @@
+#include <yahbog-tests.h>
+
+namespace {
+
+	struct round_trip_case {
+		std::string_view name;
+
+		// how far the original runs before it is saved, in frames and then cycles
+		std::size_t frames_before;
+		std::size_t cycles_before;
+
+		// how far both run after the copy is restored
+		std::size_t frames_after;
+	};
+
+	constexpr std::array round_trips{
+		round_trip_case{ "after reset",  0,   0,     120 },
+		round_trip_case{ "mid-run",      137, 0,     120 },
+		round_trip_case{ "mid-frame",    61,  12345, 120 },
+	};
+
+	enum class damage {
+		other_rom,
+		truncated,
+		bad_magic,
+		bad_version,
+		size_too_large,
+		size_too_small,
+	};
+
+	struct reject_case {
+		std::string_view name;
+		damage kind;
+	};
+
+	constexpr std::array rejects{
+		reject_case{ "another ROM",    damage::other_rom },
+		reject_case{ "truncated",      damage::truncated },
+		reject_case{ "bad magic",      damage::bad_magic },
+		reject_case{ "bad version",    damage::bad_version },
+		reject_case{ "size too large", damage::size_too_large },
+		reject_case{ "size too small", damage::size_too_small },
+	};
+
+	std::uint8_t buttons_at(std::size_t frame) {
+		return static_cast<std::uint8_t>(frame / 7 * 0x35);
+	}
+
+	// Saves the original, restores the state into a fresh emulator and runs both
+	// on, checking that they save byte-identical states after every frame
+	std::string run_round_trip(const round_trip_case& c) {
+		auto original = TestSuite::create_activity_emulator();
+		for (std::size_t frame = 0; frame < c.frames_before; frame++) {
+			original->set_buttons(buttons_at(frame));
+			original->run_frame();
+		}
+		original->run_cycles(c.cycles_before);
+
+		const auto state = TestSuite::save(*original);
+		if (state.size() != original->state_size()) {
+			return std::format("saved {} bytes, but state_size() is {}", state.size(), original->state_size());
+		}
+
+		auto restored = TestSuite::create_activity_emulator();
+		restored->load_state(state);
+		if (TestSuite::save(*restored) != state) {
+			return "the restored emulator saves a different state";
+		}
+
+		for (std::size_t frame = 0; frame < c.frames_after; frame++) {
+			const auto buttons = buttons_at(c.frames_before + frame);
+			original->set_buttons(buttons);
+			restored->set_buttons(buttons);
+			original->run_frame();
+			restored->run_frame();
+
+			if (TestSuite::save(*original) != TestSuite::save(*restored)) {
+				return std::format("states diverged {} frames after restoring", frame);
+			}
+		}
+		return {};
+	}
+
+	// Damages a valid state and expects load_state to refuse it without touching
+	// the emulator it was loaded into
+	std::string run_reject(const reject_case& c) {
+		auto source = TestSuite::create_activity_emulator();
+		for (std::size_t frame = 0; frame < 30; frame++) {
+			source->set_buttons(buttons_at(frame));
+			source->run_frame();
+		}
+		auto state = TestSuite::save(*source);
+
+		auto target = TestSuite::create_activity_emulator();
+		switch (c.kind) {
+		case damage::other_rom: {
+			auto image = TestSuite::activity_rom();
+			image[0x7FFF] ^= 0xFF;
+			target->rom.load_rom(std::move(image));
+			target->reset();
+			break;
+		}
+		case damage::truncated:
+			state.resize(state.size() / 2);
+			break;
+		case damage::bad_magic:
+			state[0] ^= std::byte{ 0xFF };
+			break;
+		case damage::bad_version:
+			state[offsetof(yahbog::state_header, version)] ^= std::byte{ 0x01 };
+			break;
+		case damage::size_too_large:
+		case damage::size_too_small: {
+			// the header and the buffer agree, but the body is another size
+			std::uint64_t size = state.size();
+			if (c.kind == damage::size_too_large) {
+				size += 16;
+				state.resize(size);
+			}
+			else {
+				size -= 4;
+			}
+			std::memcpy(state.data() + offsetof(yahbog::state_header, size), &size, sizeof(size));
+			break;
+		}
+		}
+
+		const auto before = TestSuite::save(*target);
+		try {
+			target->load_state(state);
+		}
+		catch (const std::invalid_argument&) {
+			if (TestSuite::save(*target) != before) {
+				return "the rejected state was partly loaded";
+			}
+			return {};
+		}
+		return "the damaged state was accepted";
+	}
+
+	// A buffer one byte short must throw instead of writing past its end
+	std::string run_short_buffer() {
+		auto emu = TestSuite::create_activity_emulator();
+		std::vector<std::byte> state(emu->state_size() - 1);
+		try {
+			emu->save_state(state);
+		}
+		catch (const std::out_of_range&) {
+			return {};
+		}
+		return "saving into a short buffer did not throw";
+	}
+
+}
+
+bool run_savestate_tests() {
+	TestSuite::test_suite_runner suite("Savestate Tests");
+	suite.start();
+
+	suite.print_info("🔍 Saving, restoring and rejecting states in " + std::to_string(round_trips.size() + rejects.size() + 1) + " cases");
+	std::cout << "\n";
+
+	for (const auto& c : round_trips) {
+		TestSuite::run_test(suite, c.name, [&] { return run_round_trip(c); });
+	}
+	for (const auto& c : rejects) {
+		TestSuite::run_test(suite, c.name, [&] { return run_reject(c); });
+	}
+	TestSuite::run_test(suite, "short buffer", run_short_buffer);
+
+	suite.finish();
+	return suite.passed();
+}
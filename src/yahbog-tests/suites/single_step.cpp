@@ -265,59 +265,40 @@ bool run_single_step_tests() {
 
 	load_progress.finish();
 
-	const auto num_threads = std::thread::hardware_concurrency();
+	yahbog::thread_pool pool;
+	const auto num_threads = pool.size();
 	suite.print_info("⚡ Running tests with " + std::to_string(num_threads) + " threads...");
 
 	// Test execution progress
 			TestSuite::progress_tracker test_progress(file_total);
 	test_progress.start("Running...");
 
-	const auto per_thread = test_data.size() / num_threads;
-	std::vector<std::thread> threads{};
 	std::atomic<int> completed_tests{0};
 
-	std::span<const std::string> data_span{ test_data.data(), test_data.size() };
-	std::span<std::uint8_t> results_span{ test_results.data(), test_results.size() };
+	// files differ a lot in size, so the pool balances them by stealing
+	pool.parallel_for(test_data.size(), [&](std::size_t i) {
+		test_results[i] = 1;
 
-	// Enhanced test thread function with progress tracking
-	auto enhanced_test_thread = [&](std::span<const std::string> data, std::span<std::uint8_t> results) {
-		for (std::size_t i = 0; i < data.size(); i++) {
-			results[i] = 1;
+		try {
+			nlohmann::json j = nlohmann::json::parse(test_data[i]);
 
-			try {
-				nlohmann::json j = nlohmann::json::parse(data[i]);
+			for (auto& test : j) {
+				test_info info = test_info::from_json(test);
+				auto result = info.run();
 
-				for (auto& test : j) {
-					test_info info = test_info::from_json(test);
-					auto result = info.run();
-
-					if(!result) {
-						results[i] = 0;
-						break;
-					}
+				if(!result) {
+					test_results[i] = 0;
+					break;
 				}
 			}
-			catch (const std::exception& e) {
-				results[i] = 0;
-			}
-			
-			int current = completed_tests.fetch_add(1) + 1;
-			test_progress.update(current);
 		}
-	};
-
-	for (auto i = 0; i < num_threads; i++) {
-		auto start = i * per_thread;
-		auto end = (i + 1) * per_thread;
-		if (i == num_threads - 1) {
-			end = test_data.size();
+		catch (const std::exception& e) {
+			test_results[i] = 0;
 		}
-		threads.emplace_back(enhanced_test_thread, data_span.subspan(start, end - start), results_span.subspan(start, end - start));
-	}
-
-	for (auto& thread : threads) {
-		thread.join();
-	}
+		
+		int current = completed_tests.fetch_add(1) + 1;
+		test_progress.update(current);
+	});
 
 	test_progress.finish();
 
@@ -0,0 +1,386 @@
+#include <yahbog-tests.h>
+
+#include <fstream>
+
+#include <yahbog_c.h>
+
+namespace {
+
+	constexpr std::size_t envs = 4;
+
+	const std::vector<yahbog::ram_range> ram{ { 0xC000, 32 }, { 0xFF80, 8 } };
+
+	std::uint8_t action_at(std::size_t env, std::size_t step) {
+		return static_cast<std::uint8_t>((step / 4 + env) * 0x29);
+	}
+
+	// The observation vector_env writes for an emulator
+	std::vector<std::uint8_t> observe(yahbog::emulator& emu) {
+		std::vector<std::uint8_t> obs(emu.ppu.framebuffer().begin(), emu.ppu.framebuffer().end());
+		for (const auto& range : ram) {
+			for (std::size_t a = range.start; a < range.start + std::size_t{ range.length }; a++) {
+				obs.push_back(emu.mmu.read(static_cast<std::uint16_t>(a)));
+			}
+		}
+		return obs;
+	}
+
+	std::span<const std::uint8_t> slot(const std::vector<std::uint8_t>& observations, std::size_t env, std::size_t size) {
+		return std::span(observations).subspan(env * size, size);
+	}
+
+	// Shared by the cases: a prototype partway into the activity ROM and the
+	// buffers for one step of all envs
+	struct fixture {
+		std::unique_ptr<yahbog::emulator> prototype = TestSuite::create_activity_emulator();
+		yahbog::vector_env env;
+
+		std::vector<std::uint8_t> actions = std::vector<std::uint8_t>(envs);
+		std::vector<std::uint8_t> observations;
+		std::vector<float> rewards = std::vector<float>(envs);
+		std::vector<std::uint8_t> dones = std::vector<std::uint8_t>(envs);
+
+		explicit fixture(yahbog::vector_env_options options = {})
+			: env(warm_up(*prototype), with_defaults(std::move(options))),
+			observations(envs * env.observation_size()) {}
+
+		static const yahbog::emulator& warm_up(yahbog::emulator& emu) {
+			for (std::size_t frame = 0; frame < 10; frame++) {
+				emu.run_frame();
+			}
+			return emu;
+		}
+
+		static yahbog::vector_env_options with_defaults(yahbog::vector_env_options options) {
+			options.envs = envs;
+			options.threads = 3;
+			options.ram = ram;
+			return options;
+		}
+
+		void step(std::size_t n) {
+			for (std::size_t i = 0; i < envs; i++) {
+				actions[i] = action_at(i, n);
+			}
+			env.step(actions, observations, rewards, dones);
+		}
+
+		// A copy of the prototype run the way vector_env runs its envs
+		std::unique_ptr<yahbog::emulator> serial() const {
+			auto emu = prototype->clone();
+			emu->spu.set_synthesis(false);
+			return emu;
+		}
+	};
+
+	// Every env runs like its own emulator given the same actions, and writes
+	// its frame and RAM ranges into its slot of the observations
+	std::string run_matches_serial() {
+		fixture f;
+		if (f.env.observation_size() != yahbog::gpu::framebuffer_size + 40) {
+			return std::format("observations are {} bytes", f.env.observation_size());
+		}
+
+		std::vector<std::unique_ptr<yahbog::emulator>> serial;
+		for (std::size_t i = 0; i < envs; i++) {
+			serial.push_back(f.serial());
+		}
+
+		f.env.reset({}, f.observations);
+		for (std::size_t step = 0; step < 60; step++) {
+			f.step(step);
+			for (std::size_t i = 0; i < envs; i++) {
+				serial[i]->set_buttons(action_at(i, step));
+				serial[i]->run_frame();
+				if (f.env[i].state_hash() != serial[i]->state_hash()) {
+					return std::format("env {} diverged in step {}", i, step);
+				}
+				if (!std::ranges::equal(slot(f.observations, i, f.env.observation_size()), observe(*serial[i]))) {
+					return std::format("env {} wrote another observation in step {}", i, step);
+				}
+				if (f.rewards[i] != 0.0f || f.dones[i]) {
+					return std::format("env {} has a reward or ended without callbacks or a step limit", i);
+				}
+			}
+		}
+		return {};
+	}
+
+	// Only the envs in the mask restart and have their observations written
+	std::string run_masked_reset() {
+		fixture f;
+		f.env.reset({}, f.observations);
+		const auto first = f.observations;
+		const auto start = f.env[0].state_hash();
+
+		for (std::size_t step = 0; step < 20; step++) {
+			f.step(step);
+		}
+
+		std::vector<std::uint64_t> before;
+		for (std::size_t i = 0; i < envs; i++) {
+			before.push_back(f.env[i].state_hash());
+		}
+		const auto stepped = f.observations;
+
+		const std::vector<std::uint8_t> mask{ 1, 0, 0, 1 };
+		f.env.reset(mask, f.observations);
+		const auto size = f.env.observation_size();
+		for (std::size_t i = 0; i < envs; i++) {
+			if (mask[i]) {
+				if (f.env[i].state_hash() != start) {
+					return std::format("env {} was not restarted", i);
+				}
+				if (!std::ranges::equal(slot(f.observations, i, size), slot(first, i, size))) {
+					return std::format("env {} was restarted with another observation", i);
+				}
+			}
+			else {
+				if (f.env[i].state_hash() != before[i]) {
+					return std::format("env {} was restarted outside the mask", i);
+				}
+				if (!std::ranges::equal(slot(f.observations, i, size), slot(stepped, i, size))) {
+					return std::format("the observation of env {} was written outside the mask", i);
+				}
+			}
+		}
+		return {};
+	}
+
+	// Episodes end at the step limit; the env reports done and its observation
+	// is already the first of the next episode
+	std::string run_step_limit() {
+		constexpr std::size_t limit = 5;
+		fixture f({ .max_episode_steps = limit });
+		f.env.reset({}, f.observations);
+		const auto first = f.observations;
+
+		auto serial = f.serial();
+		for (std::size_t step = 0; step < 3 * limit + 2; step++) {
+			f.step(step);
+
+			serial->set_buttons(action_at(0, step));
+			serial->run_frame();
+
+			const bool done = (step + 1) % limit == 0;
+			if (done) {
+				serial = f.serial();
+			}
+			for (std::size_t i = 0; i < envs; i++) {
+				if (static_cast<bool>(f.dones[i]) != done) {
+					return std::format("env {} reported done={} after step {}", i, f.dones[i], step);
+				}
+			}
+			if (f.env[0].state_hash() != serial->state_hash()) {
+				return std::format("env 0 is not where its episode is after step {}", step);
+			}
+			const auto size = f.env.observation_size();
+			if (done && !std::ranges::equal(slot(f.observations, 0, size), slot(first, 0, size))) {
+				return std::format("env 0 restarted after step {} with another observation", step);
+			}
+			if (!done && !std::ranges::equal(slot(f.observations, 0, size), observe(*serial))) {
+				return std::format("env 0 wrote another observation in step {}", step);
+			}
+		}
+		return {};
+	}
+
+	// The callbacks see each env's index and new observation; a done callback
+	// ends the episode like the step limit
+	std::string run_callbacks() {
+		std::array<std::size_t, envs> calls{};
+		std::array<std::vector<std::uint8_t>, envs> seen;
+		fixture f({
+			.reward = [&](std::size_t i, const yahbog::emulator&, std::span<const std::uint8_t> obs) {
+				seen[i].assign(obs.begin(), obs.end());
+				return static_cast<float>(i) + 0.5f;
+			},
+			.done = [&](std::size_t i, const yahbog::emulator&, std::span<const std::uint8_t>) {
+				// env i ends every i + 2 steps
+				return ++calls[i] % (i + 2) == 0;
+			},
+		});
+		f.env.reset({}, f.observations);
+
+		std::vector<std::unique_ptr<yahbog::emulator>> serial;
+		std::array<std::size_t, envs> episode_steps{};
+		for (std::size_t i = 0; i < envs; i++) {
+			serial.push_back(f.serial());
+		}
+
+		for (std::size_t step = 0; step < 20; step++) {
+			f.step(step);
+			for (std::size_t i = 0; i < envs; i++) {
+				serial[i]->set_buttons(action_at(i, step));
+				serial[i]->run_frame();
+				episode_steps[i]++;
+
+				if (f.rewards[i] != static_cast<float>(i) + 0.5f) {
+					return std::format("env {} has reward {} in step {}", i, f.rewards[i], step);
+				}
+				if (seen[i] != observe(*serial[i])) {
+					return std::format("the callbacks of env {} saw another observation in step {}", i, step);
+				}
+
+				const bool done = episode_steps[i] == i + 2;
+				if (static_cast<bool>(f.dones[i]) != done) {
+					return std::format("env {} reported done={} in step {}", i, f.dones[i], step);
+				}
+				if (done) {
+					serial[i] = f.serial();
+					episode_steps[i] = 0;
+				}
+				if (f.env[i].state_hash() != serial[i]->state_hash()) {
+					return std::format("env {} is not where its episode is after step {}", i, step);
+				}
+			}
+		}
+		return {};
+	}
+
+	// Buffers that are not one entry per env are refused before anything runs,
+	// as are options that cannot make an env
+	std::string run_rejects() {
+		fixture f;
+		f.env.reset({}, f.observations);
+		const auto hash = f.env[0].state_hash();
+
+		std::vector<std::uint8_t> short_observations(f.observations.size() - 1);
+		std::vector<std::uint8_t> short_mask(envs - 1);
+		std::vector<float> short_rewards(envs + 1);
+
+		const std::array<std::pair<std::string_view, std::function<void()>>, 4> calls{ {
+			{ "a short observation buffer", [&] { f.env.step(f.actions, short_observations, f.rewards, f.dones); } },
+			{ "too many rewards",           [&] { f.env.step(f.actions, f.observations, short_rewards, f.dones); } },
+			{ "a short mask",               [&] { f.env.reset(short_mask, f.observations); } },
+			{ "a short reset buffer",       [&] { f.env.reset({}, short_observations); } },
+		} };
+		for (const auto& [what, call] : calls) {
+			try {
+				call();
+				return std::format("{} was accepted", what);
+			}
+			catch (const std::invalid_argument&) {}
+		}
+		if (f.env[0].state_hash() != hash) {
+			return "a refused call ran the envs";
+		}
+
+		auto prototype = TestSuite::create_activity_emulator();
+		for (const auto& [what, options] : {
+			std::pair{ "no envs", yahbog::vector_env_options{ .envs = 0 } },
+			std::pair{ "a RAM range past FFFF", yahbog::vector_env_options{ .ram = { { 0xFFF0, 17 } } } } }) {
+			try {
+				yahbog::vector_env env(*prototype, options);
+				return std::format("{} was accepted", what);
+			}
+			catch (const std::invalid_argument&) {}
+		}
+		return {};
+	}
+
+	// The C interface runs the same envs, and failures come back as -1 with a
+	// message in yahbog_last_error
+	std::string run_c_api() {
+		const auto rom_path = std::filesystem::temp_directory_path() / "yahbog-vector-env.gb";
+		{
+			const auto rom = TestSuite::activity_rom();
+			std::ofstream out(rom_path, std::ios::binary);
+			out.write(reinterpret_cast<const char*>(rom.data()), rom.size());
+		}
+		struct remove_rom {
+			std::filesystem::path path;
+			~remove_rom() {
+				std::error_code ec;
+				std::filesystem::remove(path, ec);
+			}
+		} cleanup{ rom_path };
+
+		yahbog_env_config bad{ .envs = 0 };
+		if (yahbog_vector_env_create(rom_path.string().c_str(), &bad) || std::string_view(yahbog_last_error()).empty()) {
+			return "an env without envs was created without an error";
+		}
+
+		const auto c_ram = std::to_array<yahbog_ram_range>({ { 0xC000, 32 }, { 0xFF80, 8 } });
+		const yahbog_env_config config{
+			.envs = envs,
+			.threads = 2,
+			.frame = 1,
+			.ram = c_ram.data(),
+			.ram_count = c_ram.size(),
+			.max_episode_steps = 7,
+		};
+		std::unique_ptr<yahbog_vector_env, decltype(&yahbog_vector_env_destroy)> c_env(
+			yahbog_vector_env_create(rom_path.string().c_str(), &config), yahbog_vector_env_destroy);
+		if (!c_env) {
+			return std::format("the env was not created: {}", yahbog_last_error());
+		}
+
+		auto prototype = TestSuite::create_activity_emulator();
+		yahbog::vector_env env(*prototype, { .envs = envs, .threads = 2, .ram = ram, .max_episode_steps = 7 });
+		const auto size = env.observation_size();
+		if (yahbog_vector_env_size(c_env.get()) != envs || yahbog_vector_env_observation_size(c_env.get()) != size) {
+			return "the C env has another size";
+		}
+
+		std::vector<std::uint8_t> c_observations(envs * size), observations(envs * size);
+		std::vector<std::uint8_t> actions(envs), c_dones(envs), dones(envs);
+		std::vector<float> c_rewards(envs), rewards(envs);
+
+		if (yahbog_vector_env_reset(c_env.get(), nullptr, c_observations.data(), c_observations.size()) != 0) {
+			return std::format("reset failed: {}", yahbog_last_error());
+		}
+		env.reset({}, observations);
+		for (std::size_t step = 0; step < 20; step++) {
+			for (std::size_t i = 0; i < envs; i++) {
+				actions[i] = action_at(i, step);
+			}
+			if (yahbog_vector_env_step(c_env.get(), actions.data(), c_observations.data(), c_observations.size(), c_rewards.data(), c_dones.data()) != 0) {
+				return std::format("step {} failed: {}", step, yahbog_last_error());
+			}
+			env.step(actions, observations, rewards, dones);
+			if (c_observations != observations || c_dones != dones) {
+				return std::format("the C env differs in step {}", step);
+			}
+		}
+
+		if (yahbog_vector_env_step(c_env.get(), actions.data(), c_observations.data(), c_observations.size() - 1, c_rewards.data(), c_dones.data()) != -1) {
+			return "a short observation buffer was accepted";
+		}
+		if (!std::string_view(yahbog_last_error()).contains("observation bytes")) {
+			return std::format("a short observation buffer failed with '{}'", yahbog_last_error());
+		}
+		if (yahbog_vector_env_step(c_env.get(), nullptr, c_observations.data(), c_observations.size(), c_rewards.data(), c_dones.data()) != -1) {
+			return "missing actions were accepted";
+		}
+		if (!std::string_view(yahbog_last_error()).contains("actions")) {
+			return std::format("missing actions failed with '{}'", yahbog_last_error());
+		}
+		return {};
+	}
+
+	constexpr std::array<std::pair<std::string_view, std::string(*)()>, 6> cases{ {
+		{ "matches serial", run_matches_serial },
+		{ "masked reset",   run_masked_reset },
+		{ "step limit",     run_step_limit },
+		{ "callbacks",      run_callbacks },
+		{ "rejects",        run_rejects },
+		{ "C API",          run_c_api },
+	} };
+
+}
+
+bool run_vector_env_tests() {
+	TestSuite::test_suite_runner suite("Vector Env Tests");
+	suite.start();
+
+	suite.print_info("🔍 Checking vector_env and its C interface in " + std::to_string(cases.size()) + " cases");
+	std::cout << "\n";
+
+	for (const auto& [name, run] : cases) {
+		TestSuite::run_test(suite, name, run);
+	}
+
+	suite.finish();
+	return suite.passed();
+}
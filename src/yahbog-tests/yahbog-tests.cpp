@@ -129,15 +129,11 @@ namespace TestSuite {
 	static std::unique_ptr<yahbog::emulator> create_emulator() {
 		auto emu = std::make_unique<yahbog::emulator>();
 		
-		// Standard Game Boy initial register state
-		auto regs = yahbog::registers{};
-		regs.a = 0x01; regs.f = 0xB0;
-		regs.b = 0x00; regs.c = 0x13;
-		regs.d = 0x00; regs.e = 0xD8;
-		regs.h = 0x01; regs.l = 0x4D;
-		regs.sp = 0xFFFE; regs.pc = 0x0100;
-		
-		emu->z80.load_registers(regs);
+		// Standard Game Boy post-boot state
+		emu->reset();
+
+		// nothing listens, so only keep the sound registers behaving
+		emu->spu.set_synthesis(false);
 		return emu;
 	}
 
@@ -151,11 +147,6 @@ namespace TestSuite {
 
 		// Hook for serial output detection
 		emu->hook_writing([&serial_data](uint16_t addr, uint8_t value) {
-			// ignore audio registers
-			if(addr >= 0xFF10 && addr <= 0xFF3F) {
-				return true;
-			}
-
 			// ignore serial transfer registers
 			if(addr == 0xFF02) {
 				return true;
@@ -180,20 +171,14 @@ namespace TestSuite {
 				return std::uint8_t{0x00};
 			}
 
-			// ignore audio registers
-			if(addr >= 0xFF10 && addr <= 0xFF3F) {
-				return std::uint8_t{0x00};
-			}
-
 			return {};
 		});
 
 		emu->rom.load_rom(rom_path.string());
-		auto& cpu = emu->z80;
 
 		// Execute until pass/fail or timeout
 		while(cycle_count < max_cycles) {
-			cpu.cycle();
+			emu->tick();
 			cycle_count++;
 
 			if(serial_data.ends_with("Passed")) {
@@ -214,6 +199,137 @@ namespace TestSuite {
 	}
 
 
+	std::vector<std::uint8_t> activity_rom() {
+		std::vector<std::uint8_t> rom(0x8000, 0x00);
+
+		// entry point: nop; jp 0x0150
+		constexpr std::uint8_t entry[]{ 0x00, 0xC3, 0x50, 0x01 };
+		std::ranges::copy(entry, rom.begin() + 0x100);
+
+		constexpr std::uint8_t program[]{
+			0xF3,                // di
+			0x31, 0xFE, 0xFF,    // ld sp, 0xFFFE
+			// wait_vblank:
+			0xF0, 0x44,          // ldh a, (LY)
+			0xFE, 0x90,          // cp 144
+			0x20, 0xFA,          // jr nz, wait_vblank
+			0xAF,                // xor a
+			0xE0, 0x40,          // ldh (LCDC), a ; LCD off
+			0x21, 0x00, 0x80,    // ld hl, 0x8000
+			// fill_vram:
+			0x7D,                // ld a, l
+			0xAC,                // xor h
+			0x22,                // ld (hl+), a
+			0xCB, 0x6C,          // bit 5, h ; until 0xA000
+			0x28, 0xF9,          // jr z, fill_vram
+			0x21, 0x00, 0xFE,    // ld hl, 0xFE00
+			// fill_oam:
+			0x7D,                // ld a, l
+			0x87,                // add a, a
+			0x22,                // ld (hl+), a
+			0x7D,                // ld a, l
+			0xFE, 0xA0,          // cp 0xA0
+			0x20, 0xF8,          // jr nz, fill_oam
+			0x3E, 0x93,          // ld a, 0x93
+			0xE0, 0x40,          // ldh (LCDC), a ; LCD, sprites and background on
+			0x3E, 0x80,          // ld a, 0x80
+			0xE0, 0x26,          // ldh (NR52), a
+			0x3E, 0xFF,          // ld a, 0xFF
+			0xE0, 0x25,          // ldh (NR51), a
+			0x3E, 0x77,          // ld a, 0x77
+			0xE0, 0x24,          // ldh (NR50), a
+			// frame:
+			0xF0, 0x44,          // ldh a, (LY)
+			0xFE, 0x90,          // cp 144
+			0x20, 0xFA,          // jr nz, frame
+			0x3E, 0x10,          // ld a, 0x10
+			0xE0, 0x00,          // ldh (P1), a ; select the action buttons
+			0xF0, 0x00,          // ldh a, (P1)
+			0x2F,                // cpl
+			0xE6, 0x0F,          // and 0x0F
+			0x4F,                // ld c, a
+			0xEA, 0x00, 0xC0,    // ld (0xC000), a
+			0xF0, 0x80,          // ldh a, (0x80)
+			0x3C,                // inc a
+			0xE0, 0x80,          // ldh (0x80), a ; frame counter
+			0x47,                // ld b, a
+			0x81,                // add a, c
+			0xE0, 0x43,          // ldh (SCX), a
+			0xEA, 0x01, 0xFE,    // ld (0xFE01), a ; first sprite's X
+			0x79,                // ld a, c
+			0xEE, 0xE4,          // xor 0xE4
+			0xE0, 0x47,          // ldh (BGP), a
+			0xF0, 0x30,          // ldh a, (WAVE)
+			0xEA, 0x01, 0xC0,    // ld (0xC001), a ; wave RAM as the CPU sees it mid-note
+			0x78,                // ld a, b
+			0xE6, 0x07,          // and 0x07
+			0x20, 0x4A,          // jr nz, leave_vblank
+			0xAF,                // xor a
+			0xE0, 0x1A,          // ldh (NR30), a ; wave off to reload its RAM
+			0x21, 0x30, 0xFF,    // ld hl, 0xFF30
+			// fill_wave:
+			0x7D,                // ld a, l
+			0x80,                // add a, b
+			0x22,                // ld (hl+), a
+			0xCB, 0x75,          // bit 6, l ; until 0xFF40
+			0x28, 0xF9,          // jr z, fill_wave
+			0x3E, 0x15,          // ld a, 0x15
+			0xE0, 0x10,          // ldh (NR10), a
+			0x3E, 0x80,          // ld a, 0x80
+			0xE0, 0x11,          // ldh (NR11), a
+			0x3E, 0xF3,          // ld a, 0xF3
+			0xE0, 0x12,          // ldh (NR12), a
+			0x78,                // ld a, b
+			0xE0, 0x13,          // ldh (NR13), a
+			0x3E, 0x86,          // ld a, 0x86
+			0xE0, 0x14,          // ldh (NR14), a ; trigger square 1
+			0x3E, 0x5C,          // ld a, 0x5C
+			0xE0, 0x16,          // ldh (NR21), a
+			0x3E, 0xA1,          // ld a, 0xA1
+			0xE0, 0x17,          // ldh (NR22), a
+			0x78,                // ld a, b
+			0x2F,                // cpl
+			0xE0, 0x18,          // ldh (NR23), a
+			0x3E, 0xC5,          // ld a, 0xC5
+			0xE0, 0x19,          // ldh (NR24), a ; trigger square 2 with a length
+			0x3E, 0x80,          // ld a, 0x80
+			0xE0, 0x1A,          // ldh (NR30), a
+			0x3E, 0x20,          // ld a, 0x20
+			0xE0, 0x1C,          // ldh (NR32), a
+			0x78,                // ld a, b
+			0xE0, 0x1D,          // ldh (NR33), a
+			0x3E, 0x87,          // ld a, 0x87
+			0xE0, 0x1E,          // ldh (NR34), a ; trigger wave
+			0x3E, 0xF2,          // ld a, 0xF2
+			0xE0, 0x21,          // ldh (NR42), a
+			0x78,                // ld a, b
+			0xE0, 0x22,          // ldh (NR43), a
+			0x3E, 0x80,          // ld a, 0x80
+			0xE0, 0x23,          // ldh (NR44), a ; trigger noise
+			// leave_vblank:
+			0xF0, 0x44,          // ldh a, (LY)
+			0xFE, 0x90,          // cp 144
+			0x28, 0xFA,          // jr z, leave_vblank
+			0x18, 0x80,          // jr frame
+		};
+		std::ranges::copy(program, rom.begin() + 0x150);
+		return rom;
+	}
+
+	std::unique_ptr<yahbog::emulator> create_activity_emulator() {
+		auto emu = std::make_unique<yahbog::emulator>();
+		emu->rom.load_rom(activity_rom());
+		emu->reset();
+		return emu;
+	}
+
+	std::vector<std::byte> save(yahbog::emulator& emu) {
+		std::vector<std::byte> state(emu.state_size());
+		state.resize(emu.save_state(state));
+		return state;
+	}
+
+
 
 	test_suite_runner::test_suite_runner(const std::string& name) 
 		: suite_name(name), start_time(std::chrono::high_resolution_clock::now()) {}
@@ -302,6 +418,25 @@ namespace TestSuite {
 		std::cout << "\n";
 	}
 
+	void run_test(test_suite_runner& suite, std::string_view name, const std::function<std::string()>& run) {
+		auto start = std::chrono::high_resolution_clock::now();
+		std::string failure;
+		try {
+			failure = run();
+		}
+		catch (const std::exception& e) {
+			failure = e.what();
+		}
+		auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+
+		suite.print_test_line(std::string(name), failure.empty(), duration);
+		if (!failure.empty()) {
+			std::cout << termcolor::red << "   💬 " << failure << termcolor::reset << "\n";
+		}
+
+		suite.add_result(std::string(name), failure.empty(), duration, failure);
+	}
+
 	progress_tracker::progress_tracker(int total) : total_count(total), current_count(0), done(false) {}
 
 	void progress_tracker::start(const std::string& initial_message) {
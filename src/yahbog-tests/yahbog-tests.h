@@ -19,6 +19,7 @@
 #include <iomanip>
 #include <sstream>
 #include <atomic>
+#include <functional>
 
 #define TEST_DATA_DIR "testdata"
 
@@ -63,6 +64,18 @@ namespace TestSuite {
 	// Shared emulator execution functions
 	emulator_result run_rom_with_serial_check(const std::filesystem::path& rom_path);
 
+	// A 32KB ROM that keeps every part of the machine busy: each frame it scrolls
+	// the background and moves a sprite by the frame count plus the pressed
+	// buttons, stores the buttons and a wave RAM read in WRAM, and every eighth
+	// frame rewrites wave RAM and retriggers all four sound channels
+	std::vector<std::uint8_t> activity_rom();
+
+	// A post-boot emulator running activity_rom()
+	std::unique_ptr<yahbog::emulator> create_activity_emulator();
+
+	// A savestate of emu, exactly as long as save_state wrote
+	std::vector<std::byte> save(yahbog::emulator& emu);
+
 	// Helper class for managing test suite execution and reporting
 	class test_suite_runner {
 	private:
@@ -85,6 +98,10 @@ namespace TestSuite {
 						   std::chrono::milliseconds duration, const std::string& details = "");
 	};
 
+	// Runs one test case and records it in the suite. run returns why the case
+	// failed, or an empty string if it passed; exceptions count as failures.
+	void run_test(test_suite_runner& suite, std::string_view name, const std::function<std::string()>& run);
+
 	// Helper class for progress tracking with threading
 	class progress_tracker {
 	private:
@@ -103,4 +120,18 @@ namespace TestSuite {
 
 bool run_single_step_tests();
 bool run_blargg_cpu_instrs();
-bool run_blargg_general();
\ No newline at end of file
+bool run_blargg_general();
+bool run_ppu_tests();
+bool run_ppu_worker_tests();
+bool run_apu_tests();
+bool run_resampler_tests();
+bool run_apu_worker_tests();
+bool run_capture_tests();
+bool run_savestate_tests();
+bool run_rewind_tests();
+bool run_clone_tests();
+bool run_movie_tests();
+bool run_batch_tests();
+bool run_lockstep_tests();
+bool run_vector_env_tests();
+bool run_ram_gather_tests();
\ No newline at end of file